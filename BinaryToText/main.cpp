@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+
+#include "../general/common_functions.hpp"
+
+#include "program_options.hpp"
+#include "../MidasToPpf/midas_conversion.hpp"
+#include "../SifToPmf/sif_conversion.hpp"
+
+// Writes the text of each binary property of the container next to it, into the .ppf file it would have without the container.
+void convertContainer(const InputBuffer & input, const bfs::path & container_file) {
+	const PropertyContainer container = PropertyContainer::open(InputBuffer::borrow(input.view()));
+	const bfs::path plain_file = CompressedStreams::plainPath(container_file);
+	for (const string & name : container.names()) {
+		const string_view property = container.property(name);
+		if (!BinaryFormat::FileView(property, container_file.string()).hasMagic(BinaryProperty::MAGIC))
+			throw invalid_argument("The property \"" + name + "\" of the container \"" + container_file.string() + "\" is not a binary property.\n");
+		OutputBuffer output;
+		writeProperty(BinaryProperty::readProperty(property, container_file.string() + ":" + name), output);
+		output.writeToFile((plain_file.parent_path() / (plain_file.stem().string() + name + PROPERTY_EXTENSION)).string());
+	}
+}
+
+// Writes the text of the binary file next to it, the format is recognized by the magic bytes. A compressed file is decompressed, the text is not compressed.
+void convertFile(const bfs::path & binary_file) {
+	const InputBuffer stored = InputBuffer::map(binary_file);
+	const InputBuffer input = InputBuffer::decompressed(stored, binary_file);
+	if (input.view().substr(0, CONTAINER_HEADER.size()) == CONTAINER_HEADER)
+		return convertContainer(input, binary_file);
+
+	const BinaryFormat::FileView file(input.view(), binary_file.string());
+	OutputBuffer output;
+	string extension;
+	if (file.hasMagic(BinaryModel::MAGIC)) {
+		const BinaryModel::Model model = BinaryModel::readModel(input.view(), binary_file.string());
+		formatModel(model.graph, model.positive_label, model.negative_label, output);
+		extension = MODEL_EXTENSION;
+	}
+	else if (file.hasMagic(BinaryProperty::MAGIC)) {
+		writeProperty(BinaryProperty::readProperty(input.view(), binary_file.string()), output);
+		extension = PROPERTY_EXTENSION;
+	}
+	else {
+		throw invalid_argument("The file \"" + binary_file.string() + "\" is neither a binary model nor a binary property.\n");
+	}
+	const bfs::path plain_file = CompressedStreams::plainPath(binary_file);
+	output.writeToFile((plain_file.parent_path() / (plain_file.stem().string() + extension)).string());
+}
+
+int main(int argc, char ** argv) {
+	try {
+		bpo::variables_map program_options = parseProgramOptions(argc, argv);
+		convertFile(bfs::path{ program_options["FILE"].as<string>() });
+		return 0;
+	}
+	catch (exception & e) {
+		cerr << "An exception thrown: " << e.what() << endl;
+	}
+	return 1;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "../general/common_functions.hpp"
+
+/* Parse the program options - if help or version is required, terminate the program immediatelly. */
+bpo::variables_map parseProgramOptions(int argc, char ** argv) {
+	bpo::variables_map result;
+
+	// Declare the supbported options.
+	bpo::options_description visible("Execution options");
+	visible.add_options()
+		("help,h", "display help")
+		("version,v", "display version")
+		;
+	bpo::options_description invisible;
+	invisible.add_options()
+		("FILE", bpo::value<string>(), ("binary model " + BINARY_MODEL_EXTENSION + ", binary property " + BINARY_PROPERTY_EXTENSION + " or container " + CONTAINER_EXTENSION + " of binary properties").c_str())
+		;
+	bpo::options_description all;
+	all.add(visible).add(invisible);
+	bpo::positional_options_description pos_decr; pos_decr.add("FILE", 1);
+	bpo::store(bpo::command_line_parser(argc, argv).options(all).positional(pos_decr).run(), result);
+
+	if (result.count("help")) {
+		cout << "BinaryToText filename";
+		cout << "    filename: a file in the binary model or property format, written next to it as the text.";
+		cout << visible << "\n";
+		exit(0);
+	}
+
+	if (result.count("version")) {
+		cout << VERSION << "\n";
+		exit(0);
+	}
+
+	bpo::notify(result);
+	if (!result.count("FILE"))
+		throw invalid_argument("No input given, the binary file is required.\n");
+
+	return result;
+}
@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "experiment.hpp"
+#include "../general/binary_format.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file The binary property format (.ppfb), the same content as the text property of an experiment:
+///		PropertyHeader
+///		string table						the names of the stimulated, the inhibited and the measured species
+///		ConstraintRecord constraints[]		the setup of the experiment, the stimuli and the inhibitors each ordered by the name
+///		uint32_t species[]					the names of the measured species, the columns of the states
+///		double thresholds[][levels - 1]		for each measured specie the thresholds of its levels, only with the discretization
+///		uint8_t states[][species]			the values of the species in each state of the series, UNKNOWN_LEVEL where it is not known
+/// A series of a single state is stable, as in the text.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace BinaryProperty {
+	const char MAGIC[] = "PPFB"; ///< The first four bytes of the file.
+	const uint32_t FORMAT_VERSION = 1; ///< Version of the layout, follows the magic.
+	const uint8_t UNKNOWN_LEVEL = 0xFF; ///< The value of a specie that is not known in the state.
+
+	struct PropertyHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t string_count; ///< Names in the string table.
+		uint32_t constraint_count;
+		uint32_t species_count;
+		uint32_t state_count;
+		uint32_t level_count; ///< Levels of the discretization, 0 for the binarization.
+		uint32_t reserved; ///< Zero.
+		uint64_t string_offsets; ///< Offsets of the sections from the start of the file.
+		uint64_t string_data;
+		uint64_t constraints;
+		uint64_t species;
+		uint64_t thresholds;
+		uint64_t states;
+		uint64_t file_size;
+	};
+	static_assert(sizeof(PropertyHeader) == 88, "The header must have no padding.");
+
+	enum ConstraintKind : uint16_t { Stimulated = 0, Inhibited = 1 };
+
+	struct ConstraintRecord {
+		uint32_t name;
+		uint16_t kind; ///< A ConstraintKind.
+		uint16_t value; ///< The value of the component in the setup.
+	};
+
+	// Formats the property of the experiment in the binary format into the output.
+	inline void writeProperty(const Experiment & expr, OutputBuffer & output) {
+		BinaryFormat::StringTable strings;
+		vector<ConstraintRecord> constraints;
+		for (const auto & stimulus : expr.stimulated)
+			constraints.push_back({ strings.add(stimulus.first), Stimulated, static_cast<uint16_t>(stimulus.second) });
+		for (const auto & inhibitor : expr.inhibited)
+			constraints.push_back({ strings.add(inhibitor.first), Inhibited, static_cast<uint16_t>(inhibitor.second) });
+		vector<uint32_t> species;
+		for (const string & name : expr.measured)
+			species.push_back(strings.add(name));
+
+		const size_t level_count = !expr.levels ? 0 : expr.levels->empty() ? 2 : expr.levels->front().thresholds.size() + 1;
+		vector<double> thresholds;
+		if (expr.levels)
+			for (const ColumnLevels & levels : *expr.levels)
+				thresholds.insert(thresholds.end(), begin(levels.thresholds), end(levels.thresholds));
+
+		PropertyHeader header{};
+		memcpy(header.magic, MAGIC, 4);
+		header.version = FORMAT_VERSION;
+		header.string_count = strings.size();
+		header.constraint_count = static_cast<uint32_t>(constraints.size());
+		header.species_count = static_cast<uint32_t>(species.size());
+		header.state_count = static_cast<uint32_t>(expr.series.size());
+		header.level_count = static_cast<uint32_t>(level_count);
+		header.string_offsets = BinaryFormat::aligned(sizeof(PropertyHeader));
+		header.string_data = BinaryFormat::aligned(header.string_offsets + strings.offsetsSize());
+		header.constraints = BinaryFormat::aligned(header.string_data + strings.dataSize());
+		header.species = BinaryFormat::aligned(header.constraints + constraints.size() * sizeof(ConstraintRecord));
+		header.thresholds = BinaryFormat::aligned(header.species + species.size() * sizeof(uint32_t));
+		header.states = BinaryFormat::aligned(header.thresholds + thresholds.size() * sizeof(double));
+		header.file_size = header.states + static_cast<uint64_t>(expr.series.size()) * species.size();
+
+		output.reserve(header.file_size);
+		BinaryFormat::append(output, &header, 1);
+		strings.write(output, header.string_offsets, header.string_data);
+		BinaryFormat::padTo(output, header.constraints);
+		BinaryFormat::append(output, constraints.data(), constraints.size());
+		BinaryFormat::padTo(output, header.species);
+		BinaryFormat::append(output, species.data(), species.size());
+		BinaryFormat::padTo(output, header.thresholds);
+		BinaryFormat::append(output, thresholds.data(), thresholds.size());
+		BinaryFormat::padTo(output, header.states);
+		for (const size_t state_no : crange(expr.series.size())) {
+			for (const size_t species_no : cscope(expr.measured)) {
+				const uint64_t val = expr.series.getValue(state_no, species_no);
+				output << static_cast<char>(val == expr.series.unknownValue() ? UNKNOWN_LEVEL : static_cast<uint8_t>(val));
+			}
+		}
+	}
+
+	// @return	the experiment in the binary content, every section is checked to be within the file
+	inline Experiment readProperty(const string_view content, const string & file_name) {
+		const BinaryFormat::FileView file(content, file_name);
+		file.checkHeader(MAGIC, FORMAT_VERSION);
+		const PropertyHeader header = file.read<PropertyHeader>(0);
+		const vector<string> names = file.strings(header.string_offsets, header.string_data, header.string_count);
+		auto name = [&](const uint32_t string_no) -> const string & {
+			if (string_no >= names.size())
+				throw invalid_argument("The binary file \"" + file_name + "\" is damaged, a name is out of the string table.\n");
+			return names[string_no];
+		};
+		if (header.level_count == 1 || header.level_count > MAX_LEVELS)
+			throw invalid_argument("The binary file \"" + file_name + "\" is damaged, it has " + to_string(header.level_count) + " levels.\n");
+
+		Experiment result;
+		const ConstraintRecord * constraints = file.section<ConstraintRecord>(header.constraints, header.constraint_count);
+		for (const ConstraintRecord & constraint : boost::make_iterator_range(constraints, constraints + header.constraint_count))
+			(constraint.kind == Stimulated ? result.stimulated : result.inhibited)[name(constraint.name)] = constraint.value;
+		const uint32_t * species = file.section<uint32_t>(header.species, header.species_count);
+		for (const uint32_t specie : boost::make_iterator_range(species, species + header.species_count))
+			result.measured.push_back(name(specie));
+
+		if (header.level_count > 0) {
+			const size_t threshold_count = header.level_count - 1;
+			const double * thresholds = file.section<double>(header.thresholds, static_cast<uint64_t>(header.species_count) * threshold_count);
+			auto levels = make_shared<vector<ColumnLevels>>(header.species_count);
+			for (const size_t species_no : crange<size_t>(header.species_count))
+				(*levels)[species_no].thresholds.assign(thresholds + species_no * threshold_count, thresholds + (species_no + 1) * threshold_count);
+			result.levels = move(levels);
+		}
+
+		const size_t value_bits = header.level_count > 0 ? getValueBits(header.level_count) : VALUE_BITS;
+		const uint8_t * states = file.section<uint8_t>(header.states, static_cast<uint64_t>(header.state_count) * header.species_count);
+		result.series = PackedSeries(header.species_count, value_bits);
+		result.series.reserveStates(header.state_count);
+		for (const size_t state_no : crange<size_t>(header.state_count)) {
+			result.series.appendState();
+			for (const size_t species_no : crange<size_t>(header.species_count)) {
+				const uint8_t val = states[state_no * header.species_count + species_no];
+				if (val != UNKNOWN_LEVEL && val >= result.series.unknownValue())
+					throw invalid_argument("The binary file \"" + file_name + "\" is damaged, a value is out of its levels.\n");
+				result.series.setValue(state_no, species_no, val == UNKNOWN_LEVEL ? static_cast<uint8_t>(result.series.unknownValue()) : val);
+			}
+		}
+		return result;
+	}
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "midas_table.hpp"
+#include "packed_series.hpp"
+#include "../general/thread_pool.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Discretization of raw (not normalized) measurements into more levels. The thresholds of each DV column are its quantiles
+/// at 1/N, 2/N, ..., (N-1)/N, estimated by the P-square algorithm in a single pass with constant memory per threshold.
+/// A value gets the level equal to the number of the thresholds it reaches. Values closer to a threshold than the error times
+/// the range of the column are not known, so for data normalized to [0,1] the error means the same as for the binarization.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const size_t MAX_LEVELS = 16; ///< Most levels a species may be discretized into.
+
+// Streaming estimate of a single quantile by the P-square algorithm (Jain & Chlamtac, 1985)
+class P2Quantile {
+	double quantile; ///< The estimated quantile, in (0, 1).
+	size_t count = 0; ///< Number of the values seen.
+	double heights[5]; ///< Heights of the markers, the middle one is the estimate.
+	double positions[5]; ///< Actual positions of the markers.
+	double desired[5]; ///< Desired positions of the markers.
+	double increments[5]; ///< Increments of the desired positions with each value.
+
+	// @return	the height of the marker moved by the step, by the piecewise-parabolic formula
+	double parabolic(const size_t marker, const double step) const {
+		const double * q = heights;
+		const double * n = positions;
+		return q[marker] + step / (n[marker + 1] - n[marker - 1]) * ((n[marker] - n[marker - 1] + step) * (q[marker + 1] - q[marker]) / (n[marker + 1] - n[marker])
+			+ (n[marker + 1] - n[marker] - step) * (q[marker] - q[marker - 1]) / (n[marker] - n[marker - 1]));
+	}
+
+	// @return	the height of the marker moved by the step, linearly towards the neighbour
+	double linear(const size_t marker, const int step) const {
+		const size_t neighbour = marker + step;
+		return heights[marker] + step * (heights[neighbour] - heights[marker]) / (positions[neighbour] - positions[marker]);
+	}
+
+public:
+	explicit P2Quantile(const double _quantile) : quantile(_quantile) {
+		const double initial_desired[5] = { 0., 2. * quantile, 4. * quantile, 2. + 2. * quantile, 4. };
+		const double initial_increments[5] = { 0., quantile / 2., quantile, (1. + quantile) / 2., 1. };
+		for (const size_t marker : crange<size_t>(5)) {
+			positions[marker] = static_cast<double>(marker);
+			desired[marker] = initial_desired[marker];
+			increments[marker] = initial_increments[marker];
+		}
+	}
+
+	// Adds the value to the estimate.
+	void add(const double value) {
+		// The first values only fill the markers
+		if (count < 5) {
+			heights[count++] = value;
+			if (count == 5)
+				sort(heights, heights + 5);
+			return;
+		}
+		count++;
+
+		// Find the cell of the value, extend the extremes
+		size_t cell;
+		if (value < heights[0]) {
+			heights[0] = value;
+			cell = 0;
+		}
+		else if (value >= heights[4]) {
+			heights[4] = value;
+			cell = 3;
+		}
+		else {
+			cell = 0;
+			while (value >= heights[cell + 1])
+				cell++;
+		}
+		for (const size_t marker : crange<size_t>(cell + 1, 5))
+			positions[marker]++;
+		for (const size_t marker : crange<size_t>(5))
+			desired[marker] += increments[marker];
+
+		// Move the middle markers that are off their desired positions
+		for (const size_t marker : crange<size_t>(1, 4)) {
+			const double offset = desired[marker] - positions[marker];
+			if ((offset >= 1. && positions[marker + 1] - positions[marker] > 1.) || (offset <= -1. && positions[marker - 1] - positions[marker] < -1.)) {
+				const int step = offset > 0. ? 1 : -1;
+				const double height = parabolic(marker, step);
+				heights[marker] = (heights[marker - 1] < height && height < heights[marker + 1]) ? height : linear(marker, step);
+				positions[marker] += step;
+			}
+		}
+	}
+
+	// @return	the estimate of the quantile, NaN if there were no values
+	double estimate() const {
+		if (count == 0)
+			return numeric_limits<double>::quiet_NaN();
+		if (count >= 5)
+			return heights[2];
+		// Too few values for the markers, take the nearest rank
+		vector<double> values(heights, heights + count);
+		sort(begin(values), end(values));
+		return values[static_cast<size_t>(round(quantile * (count - 1)))];
+	}
+};
+
+// The discretization of a single column
+struct ColumnLevels {
+	vector<double> thresholds; ///< Ascending, one less than the levels.
+	double band; ///< Values closer than this to a threshold are not known.
+};
+
+// @return	the number of the bits of a value of a species with the given number of levels, there must be a code left for the unknown value
+inline size_t getValueBits(const size_t level_count) {
+	size_t bits = 1;
+	while ((size_t{ 1 } << bits) < level_count + 1)
+		bits++;
+	return max(bits, VALUE_BITS);
+}
+
+// The thresholds of a column estimated from its values as they come, the column need not be held in memory
+class LevelEstimator {
+	vector<P2Quantile> sketches; ///< One per threshold.
+	double lowest = numeric_limits<double>::infinity(); ///< The range of the known values.
+	double highest = -numeric_limits<double>::infinity();
+
+public:
+	explicit LevelEstimator(const size_t level_count) {
+		for (const size_t level : crange<size_t>(1, level_count))
+			sketches.emplace_back(static_cast<double>(level) / level_count);
+	}
+
+	// Adds the value, the values that are not known are skipped.
+	inline void add(const double value) {
+		if (!isfinite(value))
+			return;
+		lowest = min(lowest, value);
+		highest = max(highest, value);
+		for (P2Quantile & sketch : sketches)
+			sketch.add(value);
+	}
+
+	// @return	the levels of the values added so far, with the band the error relative to their range
+	ColumnLevels levels(const double error) const {
+		ColumnLevels result;
+		for (const P2Quantile & sketch : sketches)
+			result.thresholds.push_back(sketch.estimate());
+		sort(begin(result.thresholds), end(result.thresholds));
+		result.band = highest > lowest ? error * (highest - lowest) : 0.;
+		return result;
+	}
+};
+
+// @return	the thresholds of the column estimated in a single pass over its known values
+inline ColumnLevels computeLevels(const vector<double> & values, const size_t level_count, const double error) {
+	LevelEstimator estimator(level_count);
+	for (const double value : values)
+		estimator.add(value);
+	return estimator.levels(error);
+}
+
+// @return	the code of an unknown value of a species with the given number of levels
+inline uint8_t getUnknownLevel(const size_t level_count) {
+	return static_cast<uint8_t>((1u << getValueBits(level_count)) - 1);
+}
+
+// @return	the level of the value, the unknown code if it is not a finite number or it is within the band (widened by the spread) around a threshold
+inline uint8_t discretize(const double value, const ColumnLevels & levels, const uint8_t unknown, const double spread = 0.) {
+	if (!isfinite(value))
+		return unknown;
+	uint8_t level = 0;
+	for (const double threshold : levels.thresholds) {
+		if (abs(value - threshold) < levels.band + spread || isnan(threshold))
+			return unknown;
+		level += value >= threshold;
+	}
+	return level;
+}
+
+// @return	the thresholds of each DV column, empty for the other columns
+inline vector<ColumnLevels> computeColumnLevels(const vector<size_t> & DV_columns, const MidasTable & data, const size_t level_count, const double error,
+		const size_t thread_count) {
+	vector<ColumnLevels> result(data.measured_values.size());
+	forEachParallel(thread_count, DV_columns, [&](const size_t column_no) {
+		result[column_no] = computeLevels(data.measured_values[column_no], level_count, error);
+	});
+	return result;
+}
+
+// @return	for each DV column the levels of its values in row order, empty for the other columns
+inline vector<vector<uint8_t>> discretizeColumns(const vector<size_t> & DV_columns, const MidasTable & data, const vector<ColumnLevels> & levels,
+		const size_t level_count, const size_t thread_count) {
+	const uint8_t unknown = getUnknownLevel(level_count);
+	vector<vector<uint8_t>> result(data.measured_values.size());
+	forEachParallel(thread_count, DV_columns, [&](const size_t column_no) {
+		const vector<double> & values = data.measured_values[column_no];
+		result[column_no].resize(values.size());
+		for (const size_t row_no : cscope(values))
+			result[column_no][row_no] = discretize(values[row_no], levels[column_no], unknown);
+	});
+	return result;
+}
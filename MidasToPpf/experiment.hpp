@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "discretization.hpp"
+
+// Holds data about a single experiment - the experimental set-up and the time series measurements
+struct Experiment {
+	map <string, size_t> stimulated;
+	map <string, size_t> inhibited;
+	vector<string> measured;
+	PackedSeries series;
+	shared_ptr<const vector<ColumnLevels>> levels; ///< The discretization of each measured species, shared by the experiments of a file, null for the binarization.
+};
+
+// @return names of the components that were tempered with for this experiment
+inline map<string, size_t> getAffected(const vector<CompData> & components, const map<size_t, string_view> & expr_setup, const CompData::CompType comp_type) {
+	map<string, size_t> result;
+	
+	// Take the comonents that have the required type and see if they are active in the setup - if so, add their names
+	for (const CompData & component : components) {
+		if (component.comp_type != comp_type)
+			continue;
+		size_t val = stoul(string{ expr_setup.find(component.column_no)->second });
+		result.insert(make_pair(component.name, val));
+	}
+
+	return result;
+}
+
+// @return	string naming the experimental conditions (names of components that have been tampered with)
+inline string getExprName(const Experiment & experiment) {
+	string result = "";
+
+	auto addSetup = [&result](const map<string, size_t> conditions) {
+		for (const auto & condition : conditions)
+			if (condition.second != 0)
+				result.append("_" + condition.first); 
+	};
+	
+	addSetup(experiment.stimulated);
+	addSetup(experiment.inhibited);
+
+	return result;
+}
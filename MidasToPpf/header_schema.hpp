@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "../general/common_functions.hpp"
+
+// A POD structure that holds results for a component
+struct CompData {
+	size_t column_no; ///< Index of the column holding its values.
+	string name; ///< Name of the component.
+	enum CompType { Stimulated, Inhibited, Measured } comp_type; ///< Type of the current component
+};
+
+// The header of a MIDAS file compiled into the roles of its columns. Files that share the header share the schema.
+struct HeaderSchema {
+	string header; ///< The header line the schema was compiled from.
+	size_t column_count = 0; ///< Number of columns on the header line.
+	vector<CompData> components; ///< Columns that hold components, in the order of the columns.
+	vector<size_t> TR_columns; ///< Columns of the experimental setup, the inhibited ones first, then the stimulated ones.
+	vector<size_t> DV_columns; ///< Columns of the measured values.
+	vector<string> measured; ///< Names of the measured components, in the order of DV_columns.
+	size_t DA_column = INF; ///< Column that holds times, INF if there is none.
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Classification of the column names. Each matcher accepts exactly what the respective regular expression does
+/// (ECMAScript, where . does not match line terminators):
+///		CELL_LINE	"TR:.*:CellLine"		MEASURE_T	"DA:.*"				DATA_VAL	"DV:.*"
+///		INHIBITORS	"TR:.*:Inhibitors"		STIMULI		"TR:.* : Stimuli"	TR_I		"TR:.*i"		TR_NON_I	"TR:.*[^i]"
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace HeaderMatch {
+	// @return	true iff the name is prefix + anything without line breaks + suffix
+	inline bool matches(const string_view name, const string_view prefix, const string_view suffix) {
+		if (name.size() < prefix.size() + suffix.size() || name.substr(0, prefix.size()) != prefix || name.substr(name.size() - suffix.size()) != suffix)
+			return false;
+		const string_view middle = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+		return middle.find_first_of("\r\n") == string_view::npos;
+	}
+
+	inline bool isCellLine(const string_view name) { return matches(name, "TR:", ":CellLine"); }
+	inline bool isTime(const string_view name) { return matches(name, "DA:", ""); }
+	inline bool isDataVal(const string_view name) { return matches(name, "DV:", ""); }
+	inline bool isInhibitors(const string_view name) { return matches(name, "TR:", ":Inhibitors"); }
+	inline bool isStimuli(const string_view name) { return matches(name, "TR:", " : Stimuli"); }
+	inline bool isTrI(const string_view name) { return matches(name, "TR:", "i"); }
+	inline bool isTrNonI(const string_view name) { return !name.empty() && name.back() != 'i' && matches(name.substr(0, name.size() - 1), "TR:", ""); }
+}
+
+/**
+ * @brief Classifies the column by a single pass of the matchers, the first one that accepts the name gives both the role and the name.
+ * A column "TR:<name> : Stimuli" also ends with i and is thus inhibited, as with the original regular expressions.
+ * @param[in] column_no	index of the column
+ * @param[in] column_name	the name on the header line
+ * @return	the component held by the column, none for the cell line, the times, the other columns and the components without a name
+ */
+inline optional<CompData> classifyColumn(const size_t column_no, const string & column_name) {
+	using namespace HeaderMatch;
+	CompData result{ column_no, "", CompData::Measured };
+	if (isCellLine(column_name))
+		return nullopt;
+	if (isDataVal(column_name))
+		result = { column_no, column_name.substr(3, column_name.size() - 3), CompData::Measured };
+	else if (isInhibitors(column_name))
+		result = { column_no, column_name.substr(3, column_name.size() - 3 - strlen(":Inhibitors")), CompData::Inhibited };
+	else if (isStimuli(column_name))
+		result = { column_no, column_name.substr(3, column_name.size() - 3 - strlen(":Stimuli")), CompData::Inhibited };
+	else if (isTrI(column_name))
+		result = { column_no, column_name.substr(3, column_name.size() - 4), CompData::Inhibited };
+	else if (isTrNonI(column_name))
+		result = { column_no, column_name.substr(3, column_name.size() - 3), CompData::Stimulated };
+	if (result.name.empty())
+		return nullopt;
+	return result;
+}
+
+// @return	IDs of columns that contain experimental setup
+inline vector<size_t> getColumnsOfType(const vector<CompData> & components, const CompData::CompType comp_type) {
+	vector<size_t> results;
+
+	for (const CompData & comp : components)
+		if (comp.comp_type == comp_type)
+			results.push_back(comp.column_no);
+
+	return results;
+}
+
+// @return names of the components that were measured
+inline vector<string> getMeasuredNames(const vector<CompData> & components) {
+	vector<string> result;
+
+	for (const CompData & component : components)
+		if (component.comp_type == CompData::Measured)
+			result.emplace_back(component.name);
+
+	return result;
+}
+
+// @return	the schema of the header line, each column is classified exactly once
+inline HeaderSchema compileSchema(const string_view header) {
+	HeaderSchema schema;
+	schema.header = string{ header };
+
+	vector<string> column_names;
+	alg::split(column_names, header, boost::is_any_of(","));
+	schema.column_count = column_names.size();
+
+	for (const size_t column_no : cscope(column_names)) {
+		const string & column = column_names[column_no];
+		if (schema.DA_column == INF && HeaderMatch::isTime(column))
+			schema.DA_column = column_no;
+		optional<CompData> component = classifyColumn(column_no, column);
+		if (component)
+			schema.components.push_back(move(*component));
+	}
+
+	schema.TR_columns = getColumnsOfType(schema.components, CompData::Inhibited);
+	rng::copy(getColumnsOfType(schema.components, CompData::Stimulated), back_inserter(schema.TR_columns));
+	schema.DV_columns = getColumnsOfType(schema.components, CompData::Measured);
+	schema.measured = getMeasuredNames(schema.components);
+
+	return schema;
+}
+
+// Compiled schemas shared by all the files converted in the process, keyed by the header line.
+class SchemaCache {
+	mutex access; ///< The cache may be used by several converting threads.
+	unordered_map<string, shared_ptr<const HeaderSchema>> schemas; ///< Header line -> its compiled schema.
+
+public:
+	// @return	the schema for the header line, compiled only if the header was not seen before
+	shared_ptr<const HeaderSchema> get(const string_view header) {
+		lock_guard<mutex> lock(access);
+		auto known = schemas.find(string{ header });
+		if (known == schemas.end())
+			known = schemas.emplace(string{ header }, make_shared<const HeaderSchema>(compileSchema(header))).first;
+		return known->second;
+	}
+};
@@ -0,0 +1,620 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "midas_table.hpp"
+#include "repetition_removal.hpp"
+#include "../general/thread_pool.hpp"
+#include "../general/output_buffer.hpp"
+#include "../general/profiler.hpp"
+#include "../general/conversion_cache.hpp"
+#include "property_container.hpp"
+#include "replicate_aggregation.hpp"
+#include "binary_property.hpp"
+#include "midas_partitions.hpp"
+
+const double THRESHOLD = 0.5;
+
+// Settings of the conversion
+struct ConversionSettings {
+	double error; ///< How far a readout must be from the threshold to be binarized.
+	size_t thread_count; ///< Number of worker threads.
+	string cache_dir; ///< Directory of the conversion cache, empty if the cache is not used.
+	bool container; ///< All the experiments of a file go into a single container instead of a file each.
+	size_t levels; ///< Number of the levels of the discretization by quantiles, 0 for the binarization by THRESHOLD.
+	bool aggregate; ///< The rows of an experiment are ordered by the time and the replicates of a time are merged.
+	bool binary; ///< The properties are written in the binary format.
+	CompressedStreams::Codec output_codec; ///< Compression of the written files.
+	size_t memory_limit; ///< Bytes the conversion may use, a larger file is split into partitions converted one by one. 0 for no limit.
+};
+
+// A single experimental setup
+struct ExprGroup {
+	map<size_t, string_view> setup; ///< Value of each TR column in this setup.
+	size_t rows_begin; ///< The rows measured under this setup are [rows_begin, rows_end) of the row index of the groups.
+	size_t rows_end;
+};
+
+// All the experimental setups of a table, the rows of each setup are a span of a single shared index
+struct ExprGroups {
+	vector<ExprGroup> groups; ///< The setups, ordered by their values.
+	vector<size_t> rows; ///< The row numbers grouped by the setups, in the order of the file within a setup (or of the merged rows, see aggregateReplicates).
+
+	// @return	the rows measured under the setup
+	inline RowSpan rowsOf(const size_t group_no) const {
+		return RowSpan{ rows.data() + groups[group_no].rows_begin, rows.data() + groups[group_no].rows_end };
+	}
+};
+
+// @return	all combinations of experimental conditions that occur in the source, each with the rows measured under it
+inline ExprGroups getExprGroups(const vector<size_t> & TR_columns, const MidasTable & data) {
+	// Hash the setup of each row once, the buckets then compare the actual values only on a hash match
+	vector<size_t> row_hashes(data.row_count, 0);
+	for (const size_t column_no : TR_columns) {
+		const vector<string_view> & values = data.setup_values[column_no];
+		for (const size_t row_no : crange(data.row_count))
+			boost::hash_combine(row_hashes[row_no], hash<string_view>{}(values[row_no]));
+	}
+	auto row_hash = [&row_hashes](const size_t row_no) { return row_hashes[row_no]; };
+	auto same_setup = [&TR_columns, &data](const size_t row_A, const size_t row_B) {
+		return all_of(begin(TR_columns), end(TR_columns), [&](const size_t column_no) {
+			return data.setup_values[column_no][row_A] == data.setup_values[column_no][row_B];
+		});
+	};
+
+	// Single pass over the rows, a row either opens a new group or joins the one of the first row with the same setup
+	unordered_map<size_t, size_t, decltype(row_hash), decltype(same_setup)> group_of_setup(0, row_hash, same_setup);
+	vector<size_t> group_of_row(data.row_count);
+	vector<ExprGroup> found;
+	vector<size_t> row_counts;
+	for (const size_t row_no : crange(data.row_count)) {
+		const auto inserted = group_of_setup.emplace(row_no, found.size());
+		if (inserted.second) {
+			map<size_t, string_view> setup;
+			for (const size_t column_no : TR_columns)
+				setup.insert({ column_no, data.setup_values[column_no][row_no] });
+			found.push_back({ move(setup), 0, 0 });
+			row_counts.push_back(0);
+		}
+		group_of_row[row_no] = inserted.first->second;
+		row_counts[inserted.first->second]++;
+	}
+
+	// Order the experiments by the setup values, as they have always been
+	vector<size_t> order = vrange(found.size());
+	sort(begin(order), end(order), [&found](const size_t A, const size_t B) {
+		return found[A].setup < found[B].setup;
+	});
+
+	// Lay the groups out in that order and fill the index by a counting sort, which keeps the order of the rows within a group
+	ExprGroups result;
+	vector<size_t> next(found.size());
+	size_t offset = 0;
+	for (const size_t group_no : order) {
+		next[group_no] = offset;
+		offset += row_counts[group_no];
+		result.groups.push_back({ move(found[group_no].setup), next[group_no], offset });
+	}
+	result.rows.resize(data.row_count);
+	for (const size_t row_no : crange(data.row_count))
+		result.rows[next[group_of_row[row_no]]++] = row_no;
+
+	return result;
+}
+
+// @return	the code of the value: 0 or 1 if it rounds to it and is not within the error from the threshold, UNKNOWN_VALUE otherwise (also for NaN and infinity)
+inline uint8_t binarize(const double val, const double error) {
+	// Comparisons only, so that the loops over whole columns have no branches - round(val) is 0 on (-0.5, 0.5) and 1 on [0.5, 1.5)
+	const bool known = !(abs(THRESHOLD - val) < error);
+	const bool zero = known & (val > -0.5) & (val < 0.5);
+	const bool one = known & (val >= 0.5) & (val < 1.5);
+	return static_cast<uint8_t>(UNKNOWN_VALUE - 3 * zero - 2 * one);
+}
+
+// @return	for each DV column the codes of its values in row order, empty for the other columns
+inline vector<vector<uint8_t>> binarizeColumns(const vector<size_t> & DV_columns, const MidasTable & data, const double error, const size_t thread_count) {
+	vector<vector<uint8_t>> result(data.measured_values.size());
+	forEachParallel(thread_count, DV_columns, [&](const size_t column_no) {
+		const vector<double> & values = data.measured_values[column_no];
+		result[column_no].resize(values.size());
+		// A plain counted loop over the raw arrays with everything else in locals (uint8_t stores may alias anything), so that the compiler can vectorize it
+		const double band = error;
+		const double * column = values.data();
+		uint8_t * codes = result[column_no].data();
+		const size_t row_count = values.size();
+		for (size_t row_no = 0; row_no < row_count; row_no++)
+			codes[row_no] = binarize(column[row_no], band);
+	});
+	return result;
+}
+
+/**
+ * @brief Orders the rows of each experiment by the time and merges its replicates, the rows with the same known time, into a single row.
+ * The index of the groups then holds the merged rows. A merged row is coded from the mean of the values, with the band around the thresholds
+ * widened by their standard error - replicates that disagree are unknown rather than rounded. A single row is coded exactly as without merging.
+ * @param[in] column_levels	the thresholds of each column for the discretization, ignored for the binarization
+ * @param[in,out] groups	the experiments, their rows are replaced by the merged rows
+ * @return	for each DV column the codes of the merged rows, empty for the other columns
+ */
+inline vector<vector<uint8_t>> aggregateReplicates(const vector<size_t> & DV_columns, const MidasTable & data, const vector<ColumnLevels> & column_levels,
+		const ConversionSettings & settings, ExprGroups & groups) {
+	using namespace ReplicateAggregation;
+
+	// Order the rows within each experiment by the time
+	const TimeRanks ranks = getTimeRanks(data.times, data.row_count);
+	vector<size_t> group_of_row(data.row_count), group_begins;
+	for (const size_t group_no : cscope(groups.groups)) {
+		group_begins.push_back(groups.groups[group_no].rows_begin);
+		for (const size_t row_no : groups.rowsOf(group_no))
+			group_of_row[row_no] = group_no;
+	}
+	sortSpansByTime(groups.rows, group_of_row, group_begins, ranks);
+
+	// Each run of the rows of an experiment with the same time becomes a merged row
+	vector<size_t> merged_begins;
+	for (ExprGroup & group : groups.groups) {
+		const size_t first_merged = merged_begins.size();
+		for (const size_t position : crange(group.rows_begin, group.rows_end))
+			if (position == group.rows_begin || !ranks.sameTime(groups.rows[position - 1], groups.rows[position]))
+				merged_begins.push_back(position);
+		group.rows_begin = first_merged;
+		group.rows_end = merged_begins.size();
+	}
+	const size_t merged_count = merged_begins.size();
+	merged_begins.push_back(groups.rows.size());
+
+	// Code each merged row from the moments of its values
+	const uint8_t unknown = getUnknownLevel(settings.levels);
+	vector<vector<uint8_t>> result(data.measured_values.size());
+	forEachParallel(settings.thread_count, DV_columns, [&](const size_t column_no) {
+		const vector<double> & values = data.measured_values[column_no];
+		result[column_no].resize(merged_count);
+		for (const size_t merged_no : crange(merged_count)) {
+			RunningMoments moments;
+			for (const size_t position : crange(merged_begins[merged_no], merged_begins[merged_no + 1]))
+				moments.add(values[groups.rows[position]]);
+			result[column_no][merged_no] = settings.levels > 0
+				? discretize(moments.value(), column_levels[column_no], unknown, moments.standardError())
+				: binarize(moments.value(), settings.error + moments.standardError());
+		}
+	});
+
+	groups.rows = vrange(merged_count);
+	return result;
+}
+
+// @return measured data points values, binarized and packed, in the series
+inline PackedSeries getMeasurements(const vector<size_t> & DV_columns, const vector<vector<uint8_t>> & codes, const RowSpan series, const size_t value_bits = VALUE_BITS) {
+	PackedSeries result(DV_columns.size(), value_bits);
+	result.reserveStates(series.size());
+
+	for (const size_t row_no : series) {
+		result.appendState();
+		for (const size_t species_no : cscope(DV_columns))
+			result.setValue(result.size() - 1, species_no, codes[DV_columns[species_no]][row_no]);
+	}
+
+	return result;
+}
+
+// Removes the states that repeat the state right before them, in place.
+inline void removeRedundant(PackedSeries & series) {
+	// Keep only values that differ in between two steps
+	if (series.size() == 0)
+		return;
+	size_t kept = 1;
+	for (const size_t state_no : crange<size_t>(1, series.size())) {
+		if (!series.equalStates(state_no, kept - 1))
+			series.copyState(state_no, kept++);
+	}
+	series.truncate(kept);
+}
+
+// Removes the repetitive parts of the series, in place.
+inline void removeRepetitive(PackedSeries & series) {
+	series.keepStates(RepetitionRemoval::findLoopFree(RepetitionRemoval::internStates(series)));
+}
+
+// @return	string constraining the experimental conditions (as an experiment)
+inline string getExprConst(const Experiment & experiment) {
+	string result = "";
+
+	for (const auto & stimulus : experiment.stimulated)
+		result.append("&" + stimulus.first + "=" + to_string(stimulus.second));
+
+	for (const auto & inhibiton : experiment.inhibited)
+		if (inhibiton.second != 0)
+			result.append("&" + inhibiton.first + "=0");
+
+	// Remove the prefixing & if there's any
+	if (!result.empty())
+		result = result.substr(1u);
+
+	return result;
+}
+
+// @return	the comment with the thresholds of the levels of each species, empty for the binarization
+inline string getLevelsComment(const Experiment & expr) {
+	if (!expr.levels)
+		return "";
+
+	string result = "<!-- levels " + to_string(expr.levels->empty() ? 2 : expr.levels->front().thresholds.size() + 1) + ", thresholds";
+	for (const size_t species_no : cscope(expr.measured)) {
+		result += " " + expr.measured[species_no] + "=";
+		const vector<double> & thresholds = (*expr.levels)[species_no].thresholds;
+		for (const size_t threshold_no : cscope(thresholds)) {
+			char digits[32];
+			snprintf(digits, sizeof(digits), threshold_no == 0 ? "%g" : ",%g", thresholds[threshold_no]);
+			result += digits;
+		}
+	}
+	return result + " -->\n";
+}
+
+// @return	the expected size of the property text of the experiment, used to preallocate the output
+inline size_t estimatePropertySize(const Experiment & expr) {
+	size_t state_size = strlen("	<EXPR values=\"\" stable=\"1\" />\n");
+	for (const string & name : expr.measured)
+		state_size += name.size() + strlen("=0&");
+	const size_t comment_size = expr.levels ? 32 + expr.measured.size() * 48 : 0;
+	return comment_size + strlen("<SERIES experiment=\"\">\n</SERIES>") + getExprConst(expr).size() + expr.series.size() * state_size;
+}
+
+// Produce the output
+inline void writeProperty(const Experiment & expr, OutputBuffer & out) {
+	out << getLevelsComment(expr);
+	out << "<SERIES";
+	const string constraint{ getExprConst(expr) };
+	if (!constraint.empty())
+		out << " experiment=\"" << constraint << "\"" ;
+	out << ">\n";
+
+	// Print the epxressions, the known values joined by &
+	for (const size_t state_no : crange(expr.series.size())) {
+		out << "	<EXPR values=\"";
+		bool first = true;
+		for (const size_t species_no : cscope(expr.measured)) {
+			const uint64_t val = expr.series.getValue(state_no, species_no);
+			if (val == expr.series.unknownValue())
+				continue;
+			if (!first)
+				out << '&';
+			out << expr.measured[species_no] << '=' << static_cast<size_t>(val);
+			first = false;
+		}
+		out << "\" ";
+
+		// Set stable if there is only a single measurement
+		if (expr.series.size() == 1)
+			out << "stable=\"1\" ";
+
+		out << "/>\n";
+	}
+
+	out << "</SERIES>";
+}
+
+// @return	key of the content of the property file of the experiment - the output depends only on the conditions, the measured species and the codes of the rows
+inline string getExprKey(const Experiment & expr, const vector<size_t> & DV_columns, const vector<vector<uint8_t>> & codes, const RowSpan rows) {
+	ContentHash hash;
+	hash.add(VERSION).add(getExprConst(expr));
+	for (const string & name : expr.measured)
+		hash.add(name);
+	hash.add(getLevelsComment(expr));
+	for (const size_t row_no : rows)
+		for (const size_t column_no : DV_columns)
+			hash.add(static_cast<uint64_t>(codes[column_no][row_no]));
+	return hash.hex();
+}
+
+// The experiments of a MIDAS content with everything needed to compute their series
+struct ExperimentSet {
+	shared_ptr<const HeaderSchema> schema; ///< Classification of the columns.
+	MidasTable data; ///< The content of the file.
+	vector<vector<uint8_t>> codes; ///< The binarized (or discretized) DV columns, by the rows of the index of the groups.
+	size_t value_bits = VALUE_BITS; ///< Bits of a value of the series.
+	ExprGroups groups; ///< The setup and the rows of each experiment.
+	vector<Experiment> experiments; ///< The experiments ordered by their setup, the series are empty until computed.
+	vector<size_t> converted; ///< Experiments that are converted, if more share a name, only the last one is.
+};
+
+/**
+ * @brief Parses the MIDAS content and codes its DV columns.
+ * @param[in] file_levels	the levels of the columns of the whole file if the content is only a part of it, null to estimate them from the content
+ * @return	the experiments of the MIDAS content with their rows, without the series
+ */
+inline ExperimentSet prepareExperiments(InputBuffer input, const ConversionSettings & settings, SchemaCache & schemas, const vector<ColumnLevels> * file_levels = nullptr) {
+	ExperimentSet result;
+
+	// Classify the columns, files with the same header share the schema
+	Profiler::Stage classifying("classify");
+	result.schema = schemas.get(getHeader(input.view()));
+	const HeaderSchema & schema = *result.schema;
+	classifying.stop();
+
+	// Obtain data
+	Profiler::Stage parsing("parse");
+	result.data = getData(move(input), schema);
+	parsing.stop();
+
+	// Binarize the whole columns at once, or discretize them by their quantiles
+	Profiler::Stage binarizing("binarize");
+	shared_ptr<vector<ColumnLevels>> species_levels;
+	vector<ColumnLevels> column_levels;
+	if (settings.levels > 0) {
+		column_levels = file_levels ? *file_levels : computeColumnLevels(schema.DV_columns, result.data, settings.levels, settings.error, settings.thread_count);
+		result.value_bits = getValueBits(settings.levels);
+		species_levels = make_shared<vector<ColumnLevels>>();
+		for (const size_t column_no : schema.DV_columns)
+			species_levels->push_back(column_levels[column_no]);
+	}
+	// With the aggregation, the merged rows are coded instead
+	if (!settings.aggregate && settings.levels > 0)
+		result.codes = discretizeColumns(schema.DV_columns, result.data, column_levels, settings.levels, settings.thread_count);
+	else if (!settings.aggregate)
+		result.codes = binarizeColumns(schema.DV_columns, result.data, settings.error, settings.thread_count);
+	binarizing.stop();
+
+	Profiler::Stage grouping("group");
+	result.groups = getExprGroups(schema.TR_columns, result.data);
+	grouping.stop();
+
+	if (settings.aggregate) {
+		Profiler::Stage aggregating("aggregate");
+		result.codes = aggregateReplicates(schema.DV_columns, result.data, column_levels, settings, result.groups);
+	}
+
+	// Set up the experiments, the series are computed when the experiment is converted
+	for (const ExprGroup & expr_group : result.groups.groups) {
+		const map<string, size_t> inhibited = getAffected(schema.components, expr_group.setup, CompData::Inhibited);
+		const map<string, size_t> stimulated = getAffected(schema.components, expr_group.setup, CompData::Stimulated);
+		result.experiments.emplace_back(Experiment{ stimulated, inhibited, schema.measured, PackedSeries{}, species_levels });
+	}
+
+	// If more experiments share a name, only the last one would remain in the file - the others are not converted at all
+	map<string, size_t> last_of_name;
+	for (const size_t expr_no : cscope(result.experiments))
+		last_of_name[getExprName(result.experiments[expr_no])] = expr_no;
+	for (const size_t expr_no : cscope(result.experiments))
+		if (last_of_name[getExprName(result.experiments[expr_no])] == expr_no)
+			result.converted.push_back(expr_no);
+
+	return result;
+}
+
+// Computes the time series of the experiment from its rows, experiments may be computed in parallel.
+inline void computeSeries(ExperimentSet & set, const size_t expr_no) {
+	Profiler::Stage collecting("collect");
+	PackedSeries & series = set.experiments[expr_no].series;
+	series = getMeasurements(set.schema->DV_columns, set.codes, set.groups.rowsOf(expr_no), set.value_bits);
+	collecting.stop();
+
+	// Both the reductions work in place, the series is never copied
+	Profiler::Stage removing("remove_repetitions");
+	removeRedundant(series);
+	removeRepetitive(series);
+}
+
+// @return	the path of the property file of the experiment, next to the input
+inline bfs::path getPropertyPath(const bfs::path & input_path, const Experiment & expr, const bool binary = false) {
+	const bfs::path plain_path = CompressedStreams::plainPath(input_path);
+	return plain_path.parent_path() / (plain_path.stem().string() + getExprName(expr) + (binary ? BINARY_PROPERTY_EXTENSION : PROPERTY_EXTENSION));
+}
+
+// Formats the property of the experiment in the text or in the binary format.
+inline void formatProperty(const Experiment & expr, const bool binary, OutputBuffer & output) {
+	if (binary)
+		BinaryProperty::writeProperty(expr, output);
+	else
+		writeProperty(expr, output);
+}
+
+// @return	the path of the property container of the input, next to it
+inline bfs::path getContainerPath(const bfs::path & input_path) {
+	const bfs::path plain_path = CompressedStreams::plainPath(input_path);
+	return plain_path.parent_path() / (plain_path.stem().string() + CONTAINER_EXTENSION);
+}
+
+// Computes the converted experiments of the set and writes the property file of each, an experiment whose rows did not change since it was
+// written is skipped. The outputs are recorded in the cache, the caller saves it once all the outputs of the input are written.
+inline void writePropertyFiles(ExperimentSet & set, const bfs::path & input_path, const ConversionSettings & settings, optional<CacheEntry> & cache) {
+	vector<string> output_paths(set.experiments.size());
+	for (const size_t expr_no : set.converted)
+		output_paths[expr_no] = CompressedStreams::compressedPath(getPropertyPath(input_path, set.experiments[expr_no], settings.binary), settings.output_codec).string();
+
+	// Only the experiments whose rows changed are converted again
+	vector<string> expr_keys(set.experiments.size());
+	if (cache) {
+		Profiler::Stage checking("cache");
+		for (const size_t expr_no : set.converted)
+			expr_keys[expr_no] = getExprKey(set.experiments[expr_no], set.schema->DV_columns, set.codes, set.groups.rowsOf(expr_no));
+	}
+
+	// Compute the xperiments and create output, each experiment independently
+	forEachParallel(settings.thread_count, set.converted, [&](const size_t expr_no) {
+		if (cache && cache->outputUpToDate(output_paths[expr_no], expr_keys[expr_no]))
+			return;
+
+		computeSeries(set, expr_no);
+
+		Profiler::Stage writing("write");
+		const Experiment & expr = set.experiments[expr_no];
+		OutputBuffer output(estimatePropertySize(expr));
+		formatProperty(expr, settings.binary, output);
+		output.writeToFile(output_paths[expr_no]);
+	});
+
+	if (cache)
+		for (const size_t expr_no : set.converted)
+			cache->setOutput(output_paths[expr_no], expr_keys[expr_no]);
+}
+
+// @return	size of the content of the input for the memory limit, see CompressedStreams::estimatePlainSize, 0 without the limit
+inline uintmax_t getPlainSize(const bfs::path & input_path, const ConversionSettings & settings) {
+	if (settings.memory_limit == 0)
+		return 0;
+	return CompressedStreams::estimatePlainSize(input_path, settings.memory_limit / MidasPartitions::MEMORY_PER_INPUT_BYTE);
+}
+
+// @return	true iff the conversion of the content of the size in memory would not fit into the memory limit
+inline bool needsPartitions(const uintmax_t plain_size, const ConversionSettings & settings) {
+	return settings.memory_limit != 0 && plain_size * MidasPartitions::MEMORY_PER_INPUT_BYTE > settings.memory_limit;
+}
+
+/**
+ * @brief Converts a MIDAS file larger than the memory limit partition by partition, the outputs are the same as in memory.
+ * The properties of a container are collected in a temporary file and written in the order of their setups once all the partitions are converted.
+ * @param[in] plain_size	size of the content of the input, see getPlainSize
+ * @return	path of the container, empty without it
+ */
+inline string convertPartitioned(const bfs::path & input_path, const uintmax_t plain_size, const ConversionSettings & settings, SchemaCache & schemas,
+		optional<CacheEntry> & cache) {
+	ExternalSort::TemporaryDirectory directory;
+	const MidasPartitions::SplitFile split = MidasPartitions::splitFile(input_path, directory, schemas,
+		MidasPartitions::getPartitionCount(plain_size, settings.memory_limit), settings.levels, settings.error, settings.memory_limit);
+
+	// The position of each property in the temporary file, with the setup of its experiment to order them by
+	struct PropertyRecord {
+		vector<string> setup;
+		string name;
+		size_t offset;
+		size_t length;
+	};
+	vector<PropertyRecord> records;
+	const bfs::path properties_path = directory.newFile();
+	ExternalSort::RunFile<ofstream> properties(properties_path, ios::out);
+	size_t properties_size = 0;
+
+	for (const bfs::path & partition : split.partitions) {
+		ExperimentSet set = prepareExperiments(InputBuffer::map(partition), settings, schemas, &split.column_levels);
+		if (!settings.container) {
+			writePropertyFiles(set, input_path, settings, cache);
+			continue;
+		}
+
+		forEachParallel(settings.thread_count, set.converted, [&set](const size_t expr_no) {
+			computeSeries(set, expr_no);
+		});
+		Profiler::Stage writing("write");
+		for (const size_t expr_no : set.converted) {
+			const Experiment & expr = set.experiments[expr_no];
+			OutputBuffer property(estimatePropertySize(expr));
+			formatProperty(expr, settings.binary, property);
+			vector<string> setup;
+			for (const auto & value : set.groups.groups[expr_no].setup)
+				setup.emplace_back(value.second);
+			records.push_back({ move(setup), getExprName(expr), properties_size, property.str().size() });
+			properties_size += property.str().size();
+			property.flushTo(properties.get());
+		}
+	}
+	if (!settings.container)
+		return "";
+
+	// The properties follow in the order of the setups, as in memory
+	Profiler::Stage writing("write");
+	if (!properties.get().flush())
+		throw runtime_error("Could not write the temporary file \"" + properties_path.string() + "\".\n");
+	sort(begin(records), end(records), [](const PropertyRecord & A, const PropertyRecord & B) {
+		return A.setup < B.setup;
+	});
+	const bfs::path container_path = CompressedStreams::compressedPath(getContainerPath(input_path), settings.output_codec);
+	bios::filtering_ostream container;
+	CompressedStreams::openOutput(container, container_path);
+	container << CONTAINER_HEADER << string(firstContainerOffset() - CONTAINER_HEADER.size(), '\n');
+	ExternalSort::RunFile<ifstream> stored(properties_path, ios::in);
+	string text;
+	vector<pair<string, size_t>> entries;
+	size_t offset = firstContainerOffset();
+	for (const PropertyRecord & record : records) {
+		const size_t next = nextContainerOffset(offset, record.length);
+		text.resize(record.length);
+		stored.get().seekg(static_cast<streamoff>(record.offset));
+		stored.get().read(&text[0], static_cast<streamsize>(record.length));
+		container << text << string(next - offset - record.length, '\n');
+		entries.emplace_back(record.name, record.length);
+		offset = next;
+	}
+	OutputBuffer index;
+	formatContainerIndex(entries, index);
+	index.flushTo(container);
+	if (!stored.get() || !container.flush())
+		throw runtime_error("Could not write the file \"" + container_path.string() + "\".\n");
+	container.reset();
+	return container_path.string();
+}
+
+// Converts a MIDAS file into property files next to it, one for each experiment, or into a single container
+inline void convertFile(const bfs::path & input_path, const ConversionSettings & settings, SchemaCache & schemas) {
+	Profiler::Stage reading("read");
+	const InputBuffer stored = InputBuffer::map(input_path);
+	reading.stop();
+
+	// With the cache, an input converted before with the same options is skipped entirely
+	optional<CacheEntry> cache;
+	string file_key;
+	if (!settings.cache_dir.empty()) {
+		Profiler::Stage checking("cache");
+		file_key = ContentHash{}.add(VERSION).add(stored.view()).add(settings.error).add(THRESHOLD).add(static_cast<uint64_t>(settings.container))
+			.add(static_cast<uint64_t>(settings.levels)).add(static_cast<uint64_t>(settings.aggregate))
+			.add(static_cast<uint64_t>(settings.binary)).add(static_cast<uint64_t>(settings.output_codec)).hex();
+		cache = CacheEntry::load(settings.cache_dir, input_path);
+		if (cache->upToDate(file_key))
+			return;
+	}
+
+	// A file too large for the memory is converted partition by partition, the outputs are the same
+	const uintmax_t plain_size = getPlainSize(input_path, settings);
+	if (needsPartitions(plain_size, settings)) {
+		const string container_path = convertPartitioned(input_path, plain_size, settings, schemas, cache);
+		if (cache) {
+			cache->setFileKey(file_key);
+			if (settings.container)
+				cache->setOutput(container_path, file_key);
+			cache->save();
+		}
+		return;
+	}
+
+	ExperimentSet set = prepareExperiments(InputBuffer::decompressed(stored, input_path), settings, schemas);
+
+	// In a container, all the experiments are computed and then written by a single write
+	if (settings.container) {
+		forEachParallel(settings.thread_count, set.converted, [&set](const size_t expr_no) {
+			computeSeries(set, expr_no);
+		});
+
+		Profiler::Stage writing("write");
+		vector<pair<string, string>> properties;
+		for (const size_t expr_no : set.converted) {
+			const Experiment & expr = set.experiments[expr_no];
+			OutputBuffer property(estimatePropertySize(expr));
+			formatProperty(expr, settings.binary, property);
+			properties.emplace_back(getExprName(expr), property.release());
+		}
+		OutputBuffer output;
+		formatContainer(properties, output);
+		const string container_path = CompressedStreams::compressedPath(getContainerPath(input_path), settings.output_codec).string();
+		output.writeToFile(container_path);
+		writing.stop();
+
+		if (cache) {
+			cache->setFileKey(file_key);
+			cache->setOutput(container_path, file_key);
+			cache->save();
+		}
+		return;
+	}
+	writePropertyFiles(set, input_path, settings, cache);
+
+	// Recorded only after all the outputs were written, a failed conversion is repeated the next time
+	if (cache) {
+		cache->setFileKey(file_key);
+		cache->save();
+	}
+}
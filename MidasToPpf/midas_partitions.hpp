@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "experiment.hpp"
+#include "../general/external_sort.hpp"
+#include "../general/profiler.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Splitting of MIDAS files larger than the memory into partitions that are converted one by one. The file is streamed once in blocks
+/// of lines and each row is appended to the partition of its setup, chosen by the hash of the name of the experiment - all the setups that
+/// share a name (and thus an output) are in the same partition, so an experiment is never split and the experiments of different partitions
+/// never collide. A partition is a MIDAS file of its own: the header and its rows in the order of the input.
+/// The levels of the discretization are estimated in the same pass, from the rows in the order of the file, so they are the same as in memory.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace MidasPartitions {
+	const size_t READ_BLOCK_SIZE = 1 << 20; ///< Bytes of the file parsed at once, a block is extended to the end of its last line.
+	const size_t MEMORY_PER_INPUT_BYTE = 16; ///< Memory of the conversion in memory per byte of the input - the table, the codes, the series and the outputs.
+	const size_t MIN_SPILL_BUFFER = 1 << 12; ///< Least bytes of the rows of a partition collected before they are appended to its file.
+	const size_t MAX_SPILL_BUFFER = 1 << 20; ///< Most bytes of the rows of a partition collected before they are appended to its file.
+	const size_t MAX_OPEN_PARTITIONS = 64; ///< Most files of the partitions open at once.
+
+	// @return	number of the partitions for the conversion of each to fit into the memory limit, twice as many as needed to leave room for an uneven split
+	inline size_t getPartitionCount(const uintmax_t plain_size, const size_t memory_limit) {
+		const uintmax_t needed = (plain_size * MEMORY_PER_INPUT_BYTE + memory_limit - 1) / memory_limit;
+		return max<size_t>(2, 2 * static_cast<size_t>(needed));
+	}
+
+	// The rows of a partition on their way to its file
+	class Partition {
+		bfs::path path; ///< The MIDAS file of the partition.
+		string collected; ///< The rows not yet appended to the file.
+		size_t row_count = 0; ///< Number of the rows added.
+		ofstream file; ///< The file while it is open.
+		size_t written_at = 0; ///< Number of the flush that appended to the file last.
+
+	public:
+		Partition(bfs::path _path, const string_view header) : path(move(_path)), collected(header) {
+			collected.push_back('\n');
+		}
+
+		// Adds the row. @return	true iff the collected rows reached the buffer size and are to be appended to the file
+		inline bool add(const string_view line, const size_t buffer_size) {
+			collected.append(line).push_back('\n');
+			row_count++;
+			return collected.size() >= buffer_size;
+		}
+
+		// Appends the collected rows to the file, the file is opened unless it is open already and stays open.
+		void flush(const size_t flush_no) {
+			if (!file.is_open())
+				file.open(path.string(), ios::out | ios::app | ios::binary);
+			file.write(collected.data(), collected.size());
+			if (!file)
+				throw runtime_error("Could not write the temporary file \"" + path.string() + "\".\n");
+			collected.clear();
+			written_at = flush_no;
+		}
+
+		// Closes the file, the next flush opens it again.
+		void close() {
+			file.close();
+			if (file.fail())
+				throw runtime_error("Could not write the temporary file \"" + path.string() + "\".\n");
+		}
+
+		inline const bfs::path & getPath() const {
+			return path;
+		}
+
+		inline bool empty() const {
+			return row_count == 0;
+		}
+
+		// @return	true iff there are rows not yet appended to the file
+		inline bool pending() const {
+			return row_count > 0 && !collected.empty();
+		}
+
+		inline bool isOpen() const {
+			return file.is_open();
+		}
+
+		inline size_t writtenAt() const {
+			return written_at;
+		}
+	};
+
+	// The partitions of a file, at most MAX_OPEN_PARTITIONS of their files are open at once - the least recently written one is closed beyond that
+	class PartitionSet {
+		vector<Partition> partitions; ///< The partitions by their numbers.
+		vector<size_t> open; ///< Numbers of the partitions with an open file.
+		size_t flush_count = 0; ///< Number of the flushes so far.
+
+		void flush(const size_t partition_no) {
+			if (!partitions[partition_no].isOpen()) {
+				if (open.size() < MAX_OPEN_PARTITIONS) {
+					open.push_back(partition_no);
+				}
+				else {
+					size_t & oldest = *min_element(begin(open), end(open), [this](const size_t A, const size_t B) {
+						return partitions[A].writtenAt() < partitions[B].writtenAt();
+					});
+					partitions[oldest].close();
+					oldest = partition_no;
+				}
+			}
+			partitions[partition_no].flush(++flush_count);
+		}
+
+	public:
+		PartitionSet(ExternalSort::TemporaryDirectory & directory, const string_view header, const size_t partition_count) {
+			partitions.reserve(partition_count);
+			while (partitions.size() < partition_count)
+				partitions.emplace_back(directory.newFile(), header);
+		}
+
+		// Adds the row to the partition, its rows are appended to its file once they reach the buffer size.
+		void add(const size_t partition_no, const string_view line, const size_t buffer_size) {
+			if (partitions[partition_no].add(line, buffer_size))
+				flush(partition_no);
+		}
+
+		// Appends the remaining rows and closes the files. @return	the files of the partitions that have any rows
+		vector<bfs::path> finish() {
+			for (const size_t partition_no : crange(partitions.size()))
+				if (partitions[partition_no].pending())
+					flush(partition_no);
+			for (const size_t partition_no : open)
+				partitions[partition_no].close();
+			open.clear();
+
+			vector<bfs::path> result;
+			for (const Partition & partition : partitions)
+				if (!partition.empty())
+					result.push_back(partition.getPath());
+			return result;
+		}
+	};
+
+	// A MIDAS file split into the partitions
+	struct SplitFile {
+		vector<bfs::path> partitions; ///< The files of the partitions that have any rows.
+		vector<ColumnLevels> column_levels; ///< The levels of each DV column estimated over the whole file, empty for the other columns and without the discretization.
+	};
+
+	/**
+	 * @brief Splits the MIDAS file into partitions in the directory, holding only a block of the file and a buffer of each partition in memory.
+	 * @param[in] partition_count	number of the partitions, see getPartitionCount
+	 * @param[in] level_count	number of the levels of the discretization, 0 for the binarization
+	 * @param[in] error	the error of the discretization, relative to the range of the column
+	 * @return	the partitions with rows and the levels of the columns
+	 */
+	inline SplitFile splitFile(const bfs::path & input_path, ExternalSort::TemporaryDirectory & directory, SchemaCache & schemas, const size_t partition_count,
+			const size_t level_count, const double error, const size_t memory_limit) {
+		Profiler::Stage splitting("split");
+		const size_t buffer_size = min(max(memory_limit / (4 * partition_count), MIN_SPILL_BUFFER), MAX_SPILL_BUFFER);
+		string header;
+		shared_ptr<const HeaderSchema> schema;
+		optional<PartitionSet> partitions;
+		vector<LevelEstimator> estimators;
+
+		ExternalSort::forEachLineBlock(input_path, READ_BLOCK_SIZE, [&](string_view block) {
+			// The first block starts with the header
+			if (!schema) {
+				size_t position = 0;
+				header = string{ nextLine(block, position) };
+				block.remove_prefix(min(position, block.size()));
+				schema = schemas.get(header);
+				partitions.emplace(directory, header, partition_count);
+				if (level_count > 0)
+					estimators.assign(schema->column_count, LevelEstimator(level_count));
+			}
+
+			// The block is parsed as a MIDAS content of its own, its rows are its non-empty lines
+			string content = header + '\n';
+			content.append(block);
+			const MidasTable table = getData(InputBuffer::borrow(content), *schema);
+			if (!estimators.empty())
+				for (const size_t column_no : schema->DV_columns)
+					for (const double value : table.measured_values[column_no])
+						estimators[column_no].add(value);
+
+			unordered_map<string, size_t> partition_of_setup;
+			string key;
+			size_t position = 0;
+			size_t row_no = 0;
+			while (position < block.size()) {
+				const string_view line = nextLine(block, position);
+				if (line.empty())
+					continue;
+
+				key.clear();
+				for (const size_t column_no : schema->TR_columns)
+					key.append(table.setup_values[column_no][row_no]).push_back(',');
+				auto known = partition_of_setup.find(key);
+				if (known == partition_of_setup.end()) {
+					map<size_t, string_view> setup;
+					for (const size_t column_no : schema->TR_columns)
+						setup.emplace(column_no, table.setup_values[column_no][row_no]);
+					const Experiment experiment{ getAffected(schema->components, setup, CompData::Stimulated), getAffected(schema->components, setup, CompData::Inhibited),
+						{}, PackedSeries{}, nullptr };
+					known = partition_of_setup.emplace(key, hash<string>{}(getExprName(experiment)) % partition_count).first;
+				}
+				partitions->add(known->second, line, buffer_size);
+				row_no++;
+			}
+		});
+
+		SplitFile result;
+		if (partitions)
+			result.partitions = partitions->finish();
+		if (level_count > 0) {
+			result.column_levels.resize(schema->column_count);
+			for (const size_t column_no : schema->DV_columns)
+				result.column_levels[column_no] = estimators[column_no].levels(error);
+		}
+		return result;
+	}
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "../general/input_buffer.hpp"
+#include "header_schema.hpp"
+
+// Columnar content of a MIDAS file. The file is tokenized in place: the setup (TR) cells are views into the source buffer,
+// the measured (DV) cells are parsed into numbers. Columns that are neither are not stored at all.
+struct MidasTable {
+	InputBuffer source; ///< The content of the file, the views point into it.
+	size_t row_count = 0; ///< Number of data rows (the header excluded).
+	vector<vector<string_view>> setup_values; ///< For each column the values of a TR column in row order, empty for other columns.
+	vector<vector<double>> measured_values; ///< For each column the values of a DV column in row order, empty for other columns.
+	vector<double> times; ///< The values of the DA column in row order, empty if there is none.
+};
+
+// A part of an index of the rows of a table, refers to the index instead of copying it
+struct RowSpan {
+	const size_t * first; ///< The first row number.
+	const size_t * last; ///< Past the last row number.
+
+	inline const size_t * begin() const {
+		return first;
+	}
+
+	inline const size_t * end() const {
+		return last;
+	}
+
+	inline size_t size() const {
+		return static_cast<size_t>(last - first);
+	}
+};
+
+// @return	the content of the line starting at the position, the position is moved past the end of the line
+inline string_view nextLine(const string_view content, size_t & position) {
+	const size_t line_end = min(content.find('\n', position), content.size());
+	const string_view line = content.substr(position, line_end - position);
+	position = line_end + 1;
+	return line;
+}
+
+// @return	the cell content as a number, infinity if it does not hold one. The whole cell must be a number, a leading + is allowed.
+inline double parseValue(const string_view cell) {
+	const char * first = cell.data();
+	const char * last = cell.data() + cell.size();
+	// from_chars does not take the plus sign, the sign must not be doubled
+	if (first != last && *first == '+' && (last - first == 1 || first[1] != '-'))
+		first++;
+
+	double value = numeric_limits<double>::infinity();
+	const auto parsed = from_chars(first, last, value);
+	if (parsed.ptr != last || first == last)
+		return numeric_limits<double>::infinity();
+	// Out of the range of double, an underflow still reads as (almost) zero, an overflow as infinity
+	if (parsed.ec == errc::result_out_of_range)
+		return strtod(string{ first, last }.c_str(), nullptr);
+	if (parsed.ec != errc{})
+		return numeric_limits<double>::infinity();
+	return value;
+}
+
+// @return	the header line of the MIDAS content
+inline string_view getHeader(const string_view content) {
+	size_t position = 0;
+	return nextLine(content, position);
+}
+
+// @return	the table with the data from the MIDAS file, only the TR, DV and DA columns of the schema are stored
+inline MidasTable getData(InputBuffer input, const HeaderSchema & schema) {
+	enum ColumnKind : char { Skipped, Setup, Measured, Time };
+
+	MidasTable table;
+	table.source = move(input);
+	const string_view content = table.source.view();
+
+	size_t position = 0;
+	const size_t column_count = schema.column_count;
+	nextLine(content, position);
+
+	vector<ColumnKind> kinds(column_count, Skipped);
+	for (const size_t column_no : schema.TR_columns)
+		kinds[column_no] = Setup;
+	for (const size_t column_no : schema.DV_columns)
+		kinds[column_no] = Measured;
+	if (schema.DA_column != INF)
+		kinds[schema.DA_column] = Time;
+
+	// Each line is one row, reserve all the columns at once
+	const size_t line_count = static_cast<size_t>(count(content.begin() + min(position, content.size()), content.end(), '\n')) + 1;
+	table.setup_values.resize(column_count);
+	table.measured_values.resize(column_count);
+	for (const size_t column_no : schema.TR_columns)
+		table.setup_values[column_no].reserve(line_count);
+	for (const size_t column_no : schema.DV_columns)
+		table.measured_values[column_no].reserve(line_count);
+	if (schema.DA_column != INF)
+		table.times.reserve(line_count);
+
+	while (position < content.size()) {
+		const string_view line = nextLine(content, position);
+		if (line.empty())
+			continue;
+
+		// Split the line on commas, store the cells that belong to the stored columns
+		size_t column_no = 0;
+		size_t cell_begin = 0;
+		while (column_no < column_count) {
+			const size_t cell_end = min(line.find(',', cell_begin), line.size());
+			const string_view cell = line.substr(cell_begin, cell_end - cell_begin);
+			if (kinds[column_no] == Setup)
+				table.setup_values[column_no].emplace_back(cell);
+			else if (kinds[column_no] == Measured)
+				table.measured_values[column_no].emplace_back(parseValue(cell));
+			else if (kinds[column_no] == Time)
+				table.times.emplace_back(parseValue(cell));
+			column_no++;
+			if (cell_end == line.size())
+				break;
+			cell_begin = cell_end + 1;
+		}
+
+		// Pad short lines so that all the columns are aligned
+		for (; column_no < column_count; column_no++) {
+			if (kinds[column_no] == Setup)
+				table.setup_values[column_no].emplace_back();
+			else if (kinds[column_no] == Measured)
+				table.measured_values[column_no].emplace_back(numeric_limits<double>::infinity());
+			else if (kinds[column_no] == Time)
+				table.times.emplace_back(numeric_limits<double>::infinity());
+		}
+
+		table.row_count++;
+	}
+
+	return table;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "../general/common_functions.hpp"
+
+const size_t VALUE_BITS = 2; ///< Bits used by a single binarized value in a packed state.
+const uint64_t VALUE_MASK = (1ull << VALUE_BITS) - 1; ///< Mask of a single binarized value.
+const uint64_t UNKNOWN_VALUE = VALUE_MASK; ///< Code of a binarized value that was not measured or could not be binarized.
+
+// A time series of states. Each state holds a value per measured species, packed into 64-bit words - by default a ternary one (0, 1 or UNKNOWN_VALUE),
+// with more levels each value takes more bits and the unknown value is the one with all the bits set.
+// The states are stored one after another in a single buffer and the unused bits of the last word of a state are always zero,
+// so states are compared and hashed word by word.
+class PackedSeries {
+	size_t species_count = 0; ///< Number of values in a state.
+	size_t value_bits = VALUE_BITS; ///< Bits used by a single value.
+	size_t values_per_word = 64 / VALUE_BITS; ///< Values packed in a single word, a value never spans two words.
+	size_t words_per_state = 1; ///< Number of words taken by a state, at least one so that even an empty state is stored.
+	vector<uint64_t> words; ///< The states, each words_per_state long.
+
+public:
+	PackedSeries() = default;
+	explicit PackedSeries(const size_t _species_count, const size_t _value_bits = VALUE_BITS)
+		: species_count(_species_count), value_bits(_value_bits), values_per_word(64 / _value_bits),
+		words_per_state(max<size_t>(1, (_species_count + values_per_word - 1) / values_per_word)) {}
+
+	// @return	the code of a value that is not known
+	inline uint64_t unknownValue() const {
+		return (1ull << value_bits) - 1;
+	}
+
+	// @return	number of states in the series
+	inline size_t size() const {
+		return words.size() / words_per_state;
+	}
+
+	// @return	number of values in each state
+	inline size_t speciesCount() const {
+		return species_count;
+	}
+
+	// Adds a state with all the values set to 0.
+	inline void appendState() {
+		words.resize(words.size() + words_per_state, 0);
+	}
+
+	// Sets the value of the species in the state, the value must be 0 before.
+	inline void setValue(const size_t state_no, const size_t species_no, const uint64_t value) {
+		words[state_no * words_per_state + species_no / values_per_word] |= value << (species_no % values_per_word * value_bits);
+	}
+
+	// @return	the value of the species in the state
+	inline uint64_t getValue(const size_t state_no, const size_t species_no) const {
+		return (words[state_no * words_per_state + species_no / values_per_word] >> (species_no % values_per_word * value_bits)) & unknownValue();
+	}
+
+	// @return	true iff the two states hold the same values
+	inline bool equalStates(const size_t state_A, const size_t state_B) const {
+		const uint64_t * A = words.data() + state_A * words_per_state;
+		const uint64_t * B = words.data() + state_B * words_per_state;
+		return equal(A, A + words_per_state, B);
+	}
+
+	// @return	hash of the values of the state
+	inline size_t hashState(const size_t state_no) const {
+		const uint64_t * state = words.data() + state_no * words_per_state;
+		return boost::hash_range(state, state + words_per_state);
+	}
+
+	// Preallocates the memory for the given number of states.
+	inline void reserveStates(const size_t state_count) {
+		words.reserve(state_count * words_per_state);
+	}
+
+	// Overwrites the target state with the source one.
+	inline void copyState(const size_t source, const size_t target) {
+		copy_n(begin(words) + source * words_per_state, words_per_state, begin(words) + target * words_per_state);
+	}
+
+	// Drops all the states from the given one on.
+	inline void truncate(const size_t state_count) {
+		words.resize(min(words.size(), state_count * words_per_state));
+	}
+
+	// Keeps only the states at the given positions, which must be ascending.
+	void keepStates(const vector<size_t> & positions) {
+		size_t target = 0;
+		for (const size_t position : positions)
+			copyState(position, target++);
+		truncate(target);
+	}
+
+	inline bool operator==(const PackedSeries & other) const {
+		return species_count == other.species_count && value_bits == other.value_bits && words == other.words;
+	}
+
+	inline bool operator!=(const PackedSeries & other) const {
+		return !(*this == other);
+	}
+};
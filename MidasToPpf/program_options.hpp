@@ -7,7 +7,7 @@
  */
 #pragma once
 
-#include "../general/common_functions.hpp"
+#include "midas_conversion.hpp"
 
 /* Parse the program options - if help or version is required, terminate the program immediatelly. */
 bpo::variables_map parseProgramOptions(int argc, char ** argv) {
@@ -20,10 +20,27 @@ bpo::variables_map parseProgramOptions(int argc, char ** argv) {
 		("version,v", "display version")
 		("error", bpo::value<double>()->default_value(0.1), 
 		"for floating point input, this value denotes how far a readout must be from threshold to be binarized (otherwise is ommited")
+		("levels", bpo::value<size_t>()->default_value(0),
+		"discretize the raw data into this many levels by the quantiles of each measured column, instead of binarizing them by 0.5 (the error is then relative to the range of the column)")
+		("aggregate", bpo::bool_switch(),
+		"order the rows of each experiment by the DA time column and merge the replicates of each time into one state by their mean, the error band is widened by their standard error")
+		("threads", bpo::value<size_t>()->default_value(1),
+		"number of worker threads, each converts and writes whole experiments, or whole files in a batch (the output is the same for any number)")
+		("cache", bpo::value<string>()->default_value(""),
+		"directory of the conversion cache, an input converted before with the same content and options is skipped, otherwise only the experiments whose data changed are written")
+		("container", bpo::bool_switch(), ("write all the experiments of a file into a single indexed " + CONTAINER_EXTENSION + " file instead of a file each").c_str())
+		("binary", bpo::bool_switch(), ("write the properties in the binary format (" + BINARY_PROPERTY_EXTENSION + "), convertible back to the text by binaryToText").c_str())
+		("memory-limit", bpo::value<size_t>()->default_value(0),
+		"megabytes of memory the conversion of a file may use, a larger file is split by the experiments into temporary files converted one by one (0 for no limit)")
+		("output-compression", bpo::value<string>()->default_value("none"),
+		("compress the written properties by none, gzip (" + GZIP_EXTENSION + " appended) or zstd (" + ZSTD_EXTENSION + "), a compressed input is recognized by its extension").c_str())
+		("serve", bpo::value<string>(),
+		"stay resident and convert the inputs sent as lines to the Unix socket at the given path, or to the standard input for -")
+		("profile", bpo::bool_switch(), "print the wall time, allocations and peak memory of each stage of the conversion as JSON to the standard error")
 		;
 	bpo::options_description invisible;
 	invisible.add_options()
-		("MIDAS", bpo::value<string>()->required(), ("MIDAS file " + MIDAS_EXTENSION + " suffix").c_str())
+		("MIDAS", bpo::value<string>(), ("MIDAS file " + MIDAS_EXTENSION + " suffix, a directory, a glob pattern or @manifest").c_str())
 		;
 	bpo::options_description all;
 	all.add(visible).add(invisible);
@@ -33,6 +50,7 @@ bpo::variables_map parseProgramOptions(int argc, char ** argv) {
 	if (result.count("help")) {
 		cout << "MidasToPpf filename";
 		cout << "    filename: data file in the MIDAS format.";
+		cout << " Batch: a directory (all its " << MIDAS_EXTENSION << " files), a glob pattern or @manifest (a file with one path per line).";
 		cout << visible << "\n";
 		exit(0);
 	}
@@ -43,6 +61,18 @@ bpo::variables_map parseProgramOptions(int argc, char ** argv) {
 	}
 
 	bpo::notify(result);
+	if (!result.count("MIDAS") && !result.count("serve"))
+		throw invalid_argument("No input given, the MIDAS file or --serve is required.\n");
 
 	return result;
-}
\ No newline at end of file
+}
+
+// @return	the settings of the conversion given by the program options
+ConversionSettings getSettings(const bpo::variables_map & po) {
+	const size_t levels = po["levels"].as<size_t>();
+	if (levels == 1 || levels > MAX_LEVELS)
+		throw invalid_argument("The number of levels must be between 2 and " + to_string(MAX_LEVELS) + ".\n");
+	return ConversionSettings{ po["error"].as<double>(), po["threads"].as<size_t>(), po["cache"].as<string>(), po["container"].as<bool>(), levels,
+		po["aggregate"].as<bool>(), po["binary"].as<bool>(), CompressedStreams::parseCodec(po["output-compression"].as<string>()),
+		po["memory-limit"].as<size_t>() << 20 };
+}
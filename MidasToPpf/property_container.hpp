@@ -0,0 +1,153 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "../general/input_buffer.hpp"
+#include "../general/output_buffer.hpp"
+#include "../general/binary_format.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file A container holding all the properties of a MIDAS file in a single file, with an index at the end:
+///		PPFC 1
+///		<SERIES ...>...</SERIES>		the text of each property, each followed by a line end
+///		INDEX <count>
+///		<offset> <length> <name>	for each property, the position of its text in the file and its name (the suffix its .ppf file would have)
+///		FOOTER <offset>				the position of the INDEX line, always 20 digits so that the footer is found at a fixed distance from the end
+/// A reader thus reads the footer and the index only and then seeks directly to the properties it needs. Every property (and the index)
+/// starts at a multiple of BinaryFormat::ALIGNMENT, the gaps are filled by line ends, so binary properties can be used in place.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const string CONTAINER_HEADER("PPFC 1\n"); ///< The first line of a container.
+const size_t CONTAINER_FOOTER_SIZE = 7 + 20 + 1; ///< Size of the last line - "FOOTER ", the digits and the line end.
+
+// @return	offset of the first property of a container
+inline size_t firstContainerOffset() {
+	return BinaryFormat::aligned(CONTAINER_HEADER.size());
+}
+
+// @return	offset of what follows the property at the offset, the property is ended by a line end and padded by more up to the alignment
+inline size_t nextContainerOffset(const size_t offset, const size_t length) {
+	return BinaryFormat::aligned(offset + length + 1);
+}
+
+// Formats the index and the footer of the container, its properties (the name and the length of each) follow the header one after another in the given order.
+inline void formatContainerIndex(const vector<pair<string, size_t>> & entries, OutputBuffer & output) {
+	output << "INDEX " << entries.size() << '\n';
+	size_t offset = firstContainerOffset();
+	for (const auto & entry : entries) {
+		output << offset << ' ' << entry.second << ' ' << entry.first << '\n';
+		offset = nextContainerOffset(offset, entry.second);
+	}
+
+	char footer[CONTAINER_FOOTER_SIZE + 1];
+	snprintf(footer, sizeof(footer), "FOOTER %020zu\n", offset);
+	output << string_view{ footer, CONTAINER_FOOTER_SIZE };
+}
+
+// Formats the properties into the container, one after another in the given order
+inline void formatContainer(const vector<pair<string, string>> & properties, OutputBuffer & output) {
+	size_t size = CONTAINER_HEADER.size() + CONTAINER_FOOTER_SIZE;
+	for (const auto & property : properties)
+		size += property.first.size() + property.second.size() + BinaryFormat::ALIGNMENT + 64;
+	output.reserve(size);
+
+	output << CONTAINER_HEADER << string(firstContainerOffset() - CONTAINER_HEADER.size(), '\n');
+	vector<pair<string, size_t>> entries;
+	size_t offset = firstContainerOffset();
+	for (const auto & property : properties) {
+		const size_t next = nextContainerOffset(offset, property.second.size());
+		output << property.second << string(next - offset - property.second.size(), '\n');
+		entries.emplace_back(property.first, property.second.size());
+		offset = next;
+	}
+	formatContainerIndex(entries, output);
+}
+
+// Read access to a container, the properties are views into the content and are located through the index only
+class PropertyContainer {
+	InputBuffer content; ///< The whole container.
+	map<string, pair<size_t, size_t>> index; ///< Name -> offset and length of the property.
+
+	// @return	the number at the start of the text, the position is moved past it and a single following space
+	static size_t readNumber(const string_view text, size_t & position) {
+		size_t value = 0;
+		const auto parsed = from_chars(text.data() + position, text.data() + text.size(), value);
+		if (parsed.ec != errc{})
+			throw runtime_error("Damaged property container index.\n");
+		position = parsed.ptr - text.data();
+		if (position < text.size() && text[position] == ' ')
+			position++;
+		return value;
+	}
+
+public:
+	NO_COPY(PropertyContainer)
+
+	/**
+	 * @brief Reads the index of the container.
+	 * @param[in] input	the whole container
+	 * @return	the container ready to be queried
+	 */
+	static PropertyContainer open(InputBuffer input) {
+		PropertyContainer result;
+		result.content = move(input);
+		const string_view text = result.content.view();
+		if (text.substr(0, CONTAINER_HEADER.size()) != CONTAINER_HEADER || text.size() < CONTAINER_HEADER.size() + CONTAINER_FOOTER_SIZE)
+			throw runtime_error("The content is not a property container.\n");
+
+		const string_view footer = text.substr(text.size() - CONTAINER_FOOTER_SIZE);
+		if (footer.substr(0, strlen("FOOTER ")) != "FOOTER ")
+			throw runtime_error("Damaged property container footer.\n");
+		size_t position = strlen("FOOTER ");
+		const size_t index_offset = readNumber(footer, position);
+		if (index_offset > text.size() - CONTAINER_FOOTER_SIZE)
+			throw runtime_error("Damaged property container footer.\n");
+
+		// The index lines, up to the footer
+		const string_view index_text = text.substr(index_offset, text.size() - CONTAINER_FOOTER_SIZE - index_offset);
+		if (index_text.substr(0, strlen("INDEX ")) != "INDEX ")
+			throw runtime_error("Damaged property container index.\n");
+		position = strlen("INDEX ");
+		const size_t count = readNumber(index_text, position);
+		position = index_text.find('\n', position);
+		if (position == string_view::npos)
+			throw runtime_error("Damaged property container index.\n");
+		position++;
+		for (size_t property_no = 0; property_no < count; property_no++) {
+			const size_t offset = readNumber(index_text, position);
+			const size_t length = readNumber(index_text, position);
+			const size_t line_end = index_text.find('\n', position);
+			if (line_end == string_view::npos || offset + length > index_offset)
+				throw runtime_error("Damaged property container index.\n");
+			result.index[string{ index_text.substr(position, line_end - position) }] = { offset, length };
+			position = line_end + 1;
+		}
+
+		return result;
+	}
+
+	// @return	names of the properties, ordered
+	vector<string> names() const {
+		vector<string> result;
+		for (const auto & entry : index)
+			result.push_back(entry.first);
+		return result;
+	}
+
+	// @return	true iff the container holds the property
+	bool contains(const string & name) const {
+		return index.count(name) > 0;
+	}
+
+	// @return	the text of the property, valid as long as the container exists
+	string_view property(const string & name) const {
+		const auto entry = index.find(name);
+		if (entry == index.end())
+			throw invalid_argument("No property \"" + name + "\" in the container.\n");
+		return content.view().substr(entry->second.first, entry->second.second);
+	}
+};
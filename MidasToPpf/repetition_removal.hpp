@@ -0,0 +1,281 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "packed_series.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Removal of repeated loops from a time series.
+///
+/// A loop is a block of states [i, i+L] that starts and ends in the same state. If the same block occurs again at some j >= i + L,
+/// the states [j, j+L[ are dropped. The earliest loop (by i, then by L, then by j) is removed first and the process is repeated until
+/// no loop repeats.
+///
+/// If a loop from i repeats, so does its prefix up to the next occurrence of the state i (the prefix occurs wherever the loop does).
+/// It is therefore enough to consider the shortest loop from each position and the removal is always the second occurrence of
+/// the repeated shortest loop that occurs first. The loops are kept in a single hash table by their content and a removal only
+/// recomputes the loops that contained the removed states, so the series is never rescanned.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace RepetitionRemoval {
+	const uint64_t HASH_MODULUS = (1ull << 61) - 1; ///< Mersenne prime modulus of the polynomial hash.
+	const uint64_t HASH_BASE = 0x100000001B3ull; ///< Multiplier of the polynomial hash.
+
+	// @return	a * b mod HASH_MODULUS
+	inline uint64_t multiplyHash(const uint64_t a, const uint64_t b) {
+		const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+		const uint64_t reduced = static_cast<uint64_t>(product & HASH_MODULUS) + static_cast<uint64_t>(product >> 61);
+		return reduced >= HASH_MODULUS ? reduced - HASH_MODULUS : reduced;
+	}
+
+	/// Content of a loop, the hash and the number of the states it spans.
+	struct LoopKey {
+		uint64_t hash;
+		size_t length;
+
+		bool operator==(const LoopKey & other) const { return hash == other.hash && length == other.length; }
+	};
+
+	struct LoopKeyHash {
+		size_t operator()(const LoopKey & key) const { return key.hash ^ (key.length * HASH_BASE); }
+	};
+
+	/// Hashes of the states that are still present, any range of the original positions is hashed in a logarithmic time.
+	class HashTree {
+		size_t leaves; ///< Number of the leaves, a power of two.
+		vector<uint64_t> hashes; ///< Hash of the present states below the node.
+		vector<size_t> counts; ///< Number of the present states below the node.
+		vector<uint64_t> powers; ///< Powers of the HASH_BASE.
+
+		// @return	the hash of the states of A followed by the states of B
+		pair<uint64_t, size_t> combine(const pair<uint64_t, size_t> & A, const pair<uint64_t, size_t> & B) const {
+			const uint64_t hash = multiplyHash(A.first, powers[B.second]) + B.first;
+			return { hash >= HASH_MODULUS ? hash - HASH_MODULUS : hash, A.second + B.second };
+		}
+
+		void update(size_t node) {
+			for (node /= 2; node > 0; node /= 2) {
+				const auto combined = combine({ hashes[2 * node], counts[2 * node] }, { hashes[2 * node + 1], counts[2 * node + 1] });
+				hashes[node] = combined.first;
+				counts[node] = combined.second;
+			}
+		}
+
+	public:
+		HashTree(const vector<uint32_t> & ids) : leaves(1) {
+			while (leaves < ids.size())
+				leaves *= 2;
+			hashes.resize(2 * leaves, 0);
+			counts.resize(2 * leaves, 0);
+			powers.resize(ids.size() + 1, 1);
+			for (const size_t position : crange(ids.size())) {
+				hashes[leaves + position] = ids[position] + 1;
+				counts[leaves + position] = 1;
+				powers[position + 1] = multiplyHash(powers[position], HASH_BASE);
+			}
+			for (size_t node = leaves - 1; node > 0; node--) {
+				const auto combined = combine({ hashes[2 * node], counts[2 * node] }, { hashes[2 * node + 1], counts[2 * node + 1] });
+				hashes[node] = combined.first;
+				counts[node] = combined.second;
+			}
+		}
+
+		void erase(const size_t position) {
+			hashes[leaves + position] = 0;
+			counts[leaves + position] = 0;
+			update(leaves + position);
+		}
+
+		// @return	key of the present states within [from, to]
+		LoopKey get(size_t from, size_t to) const {
+			pair<uint64_t, size_t> left = { 0, 0 }, right = { 0, 0 };
+			for (from += leaves, to += leaves + 1; from < to; from /= 2, to /= 2) {
+				if (from % 2 == 1) {
+					left = combine(left, { hashes[from], counts[from] });
+					from++;
+				}
+				if (to % 2 == 1) {
+					to--;
+					right = combine({ hashes[to], counts[to] }, right);
+				}
+			}
+			const auto result = combine(left, right);
+			return { result.first, result.second };
+		}
+	};
+
+	/// Ends of the loops by their starts, finds the loops that contain a given block.
+	class EndTree {
+		size_t leaves; ///< Number of the leaves, a power of two.
+		vector<size_t> ends; ///< The furthest end of a loop that starts below the node, 0 if there is none.
+
+		void collect(const size_t node, const size_t from, const size_t to, const size_t before, const size_t end, vector<size_t> & starts) const {
+			if (from >= before || ends[node] < end)
+				return;
+			if (to - from == 1) {
+				starts.push_back(from);
+				return;
+			}
+			const size_t middle = (from + to) / 2;
+			collect(2 * node, from, middle, before, end, starts);
+			collect(2 * node + 1, middle, to, before, end, starts);
+		}
+
+	public:
+		EndTree(const size_t size) : leaves(1) {
+			while (leaves < size)
+				leaves *= 2;
+			ends.resize(2 * leaves, 0);
+		}
+
+		void set(const size_t start, const size_t end) {
+			size_t node = leaves + start;
+			ends[node] = end;
+			for (node /= 2; node > 0; node /= 2)
+				ends[node] = max(ends[2 * node], ends[2 * node + 1]);
+		}
+
+		// Adds the starts of the loops that start before the given position and end at the given position or later.
+		void collectCovering(const size_t before, const size_t end, vector<size_t> & starts) const {
+			collect(1, 0, leaves, before, end, starts);
+		}
+	};
+
+	/// The states that are still present, their shortest loops and the loops that occur repeatedly.
+	class LoopRemover {
+		const vector<uint32_t> & ids; ///< IDs of the states.
+		vector<size_t> next_present; ///< The following present position.
+		vector<size_t> previous_present; ///< The preceding present position.
+		vector<size_t> next_same; ///< The following present position with the same state, the end of the shortest loop.
+		vector<size_t> previous_same; ///< The preceding present position with the same state.
+		HashTree hashes; ///< Hashes of the present states.
+		EndTree ends; ///< Ends of the present loops.
+		vector<LoopKey> keys; ///< Key of the loop that starts at the position.
+		unordered_map<LoopKey, set<size_t>, LoopKeyHash> starts; ///< Starts of the loops with the given content.
+		set<size_t> repeated; ///< The first starts of the loops that occur more than once.
+
+		void addLoop(const size_t start) {
+			if (next_same[start] == INF)
+				return;
+			keys[start] = hashes.get(start, next_same[start]);
+			set<size_t> & same = starts[keys[start]];
+			if (same.size() > 1)
+				repeated.erase(*begin(same));
+			same.insert(start);
+			if (same.size() > 1)
+				repeated.insert(*begin(same));
+			ends.set(start, next_same[start]);
+		}
+
+		void removeLoop(const size_t start) {
+			if (next_same[start] == INF)
+				return;
+			auto same = starts.find(keys[start]);
+			if (same->second.size() > 1)
+				repeated.erase(*begin(same->second));
+			same->second.erase(start);
+			if (same->second.size() > 1)
+				repeated.insert(*begin(same->second));
+			else if (same->second.empty())
+				starts.erase(same);
+			ends.set(start, 0);
+		}
+
+	public:
+		LoopRemover(const vector<uint32_t> & _ids) : ids(_ids), hashes(_ids), ends(_ids.size()), keys(_ids.size()) {
+			const size_t n = ids.size();
+			next_present.resize(n, INF);
+			previous_present.resize(n, INF);
+			next_same.resize(n, INF);
+			previous_same.resize(n, INF);
+
+			vector<size_t> last(n == 0 ? 0 : *max_element(begin(ids), end(ids)) + 1, INF);
+			for (const size_t position : crange(n)) {
+				if (position > 0) {
+					next_present[position - 1] = position;
+					previous_present[position] = position - 1;
+				}
+				if (last[ids[position]] != INF) {
+					next_same[last[ids[position]]] = position;
+					previous_same[position] = last[ids[position]];
+				}
+				last[ids[position]] = position;
+			}
+			for (const size_t position : crange(n))
+				addLoop(position);
+		}
+
+		// Removes the earliest repeated loop. @return	true iff a loop was removed
+		bool removeFirstRepetition() {
+			if (repeated.empty())
+				return false;
+
+			// The loop from i repeats at j, the states [j, loop_end[ are dropped
+			const size_t i = *begin(repeated);
+			const size_t j = *next(begin(starts[keys[i]]));
+			const size_t loop_end = next_same[j];
+			for (size_t first = i, second = j; first != next_same[i]; first = next_present[first], second = next_present[second])
+				if (ids[first] != ids[second])
+					throw runtime_error("Hash collision while removing the repeated loops.");
+
+			// Loops that span the removed states or end within them change
+			vector<size_t> changed;
+			ends.collectCovering(j, loop_end + 1, changed);
+			for (size_t position = j; position != loop_end; position = next_present[position]) {
+				removeLoop(position);
+				if (previous_same[position] != INF && previous_same[position] < j)
+					changed.push_back(previous_same[position]);
+			}
+			for (const size_t start : changed)
+				removeLoop(start);
+
+			for (size_t position = j; position != loop_end; position = next_present[position]) {
+				hashes.erase(position);
+				if (previous_same[position] != INF)
+					next_same[previous_same[position]] = next_same[position];
+				if (next_same[position] != INF)
+					previous_same[next_same[position]] = previous_same[position];
+			}
+			next_present[previous_present[j]] = loop_end;
+			previous_present[loop_end] = previous_present[j];
+
+			for (const size_t start : changed)
+				addLoop(start);
+			return true;
+		}
+
+		// @return	the present positions in ascending order
+		vector<size_t> getPresent() const {
+			vector<size_t> positions;
+			for (size_t position = ids.empty() ? INF : 0; position != INF; position = next_present[position])
+				positions.push_back(position);
+			return positions;
+		}
+	};
+
+	// @return	positions of the states that remain after all the repeated loops have been removed, in ascending order
+	inline vector<size_t> findLoopFree(const vector<uint32_t> & ids) {
+		LoopRemover remover(ids);
+		while (remover.removeFirstRepetition())
+			;
+		return remover.getPresent();
+	}
+
+	// @return	IDs of the states, equal states obtain the same ID, IDs are dense from 0
+	inline vector<uint32_t> internStates(const PackedSeries & series) {
+		auto state_hash = [&series](const size_t state_no) { return series.hashState(state_no); };
+		auto same_state = [&series](const size_t state_A, const size_t state_B) { return series.equalStates(state_A, state_B); };
+		unordered_map<size_t, uint32_t, decltype(state_hash), decltype(same_state)> known(series.size(), state_hash, same_state);
+
+		vector<uint32_t> ids;
+		ids.reserve(series.size());
+		for (const size_t state_no : crange(series.size()))
+			ids.push_back(known.emplace(state_no, static_cast<uint32_t>(known.size())).first->second);
+
+		return ids;
+	}
+}
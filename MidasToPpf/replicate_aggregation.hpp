@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "../general/common_functions.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Ordering of the rows of the experiments by the time (the DA column) and merging of the replicates.
+///
+/// The distinct times are ranked once for the whole table, the rows of all the experiments are then ordered by a two-pass counting sort
+/// on the shared row index - by the rank over the whole index and back into the spans of the experiments, both passes are stable.
+/// The rows of an experiment with the same known time are replicates, their values are merged by a streaming mean and variance.
+/// Rows without a known time are never merged and stay after the timed ones in the order of the file.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace ReplicateAggregation {
+	// Mean and variance of a stream of values by the Welford's algorithm, the values that are not finite numbers are skipped
+	struct RunningMoments {
+		size_t count = 0; ///< Number of the values added.
+		double mean = 0.; ///< Mean of the values added.
+		double squares = 0.; ///< Sum of the squared differences from the mean.
+
+		inline void add(const double value) {
+			if (!isfinite(value))
+				return;
+			count++;
+			const double delta = value - mean;
+			mean += delta / count;
+			squares += delta * (value - mean);
+		}
+
+		// @return	the mean, NaN if there were no values
+		inline double value() const {
+			return count == 0 ? numeric_limits<double>::quiet_NaN() : mean;
+		}
+
+		// @return	the standard error of the mean from the sample variance, 0 for fewer than two values
+		inline double standardError() const {
+			return count < 2 ? 0. : sqrt(squares / (count - 1) / count);
+		}
+	};
+
+	// The rank of the time of each row
+	struct TimeRanks {
+		vector<uint32_t> of_row; ///< Rank of the time of each row, the rows without a known time have the rank unknown.
+		uint32_t unknown = 0; ///< Rank after all the known times.
+
+		// @return	true iff the rows have the same known time
+		inline bool sameTime(const size_t row_A, const size_t row_B) const {
+			return of_row[row_A] == of_row[row_B] && of_row[row_A] != unknown;
+		}
+	};
+
+	// @return	the ranks of the times of the rows, all the rows are without a time if there are no times
+	inline TimeRanks getTimeRanks(const vector<double> & times, const size_t row_count) {
+		TimeRanks result;
+		if (times.empty()) {
+			result.of_row.assign(row_count, 0);
+			return result;
+		}
+
+		// Only the distinct times are sorted, there are few of them compared to the rows
+		unordered_map<double, uint32_t> rank_of_time;
+		for (const double time : times)
+			if (isfinite(time))
+				rank_of_time.emplace(time, 0);
+		vector<double> distinct;
+		distinct.reserve(rank_of_time.size());
+		for (const auto & time : rank_of_time)
+			distinct.push_back(time.first);
+		sort(begin(distinct), end(distinct));
+		for (const size_t rank : cscope(distinct))
+			rank_of_time[distinct[rank]] = static_cast<uint32_t>(rank);
+
+		result.unknown = static_cast<uint32_t>(distinct.size());
+		result.of_row.reserve(row_count);
+		for (const double time : times)
+			result.of_row.push_back(isfinite(time) ? rank_of_time[time] : result.unknown);
+		return result;
+	}
+
+	/**
+	 * @brief Orders the rows within each span of the index by their times, stably, in linear time.
+	 * @param[in,out] rows	the row index, each span is a contiguous part of it
+	 * @param[in] span_of_row	the span each row belongs to
+	 * @param[in] span_begins	the position of each span in the index
+	 * @param[in] ranks	the time of each row
+	 */
+	inline void sortSpansByTime(vector<size_t> & rows, const vector<size_t> & span_of_row, const vector<size_t> & span_begins, const TimeRanks & ranks) {
+		// By the rank over the whole index
+		vector<size_t> offsets(static_cast<size_t>(ranks.unknown) + 2, 0);
+		for (const size_t row_no : rows)
+			offsets[ranks.of_row[row_no] + 1]++;
+		partial_sum(begin(offsets), end(offsets), begin(offsets));
+		vector<size_t> by_time(rows.size());
+		for (const size_t row_no : rows)
+			by_time[offsets[ranks.of_row[row_no]]++] = row_no;
+
+		// Back into the spans, the order by the rank remains within each
+		vector<size_t> next = span_begins;
+		for (const size_t row_no : by_time)
+			rows[next[span_of_row[row_no]]++] = row_no;
+	}
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "sif_graph.hpp"
+#include "../general/binary_format.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file The binary model format (.pmfb), the same content as the text model:
+///		ModelHeader
+///		string table			the names of the nodes and the two labels
+///		uint32_t inputs[]		the names of the inputs, ordered by the name
+///		SpecieRecord species[]	ordered by the name, each with a range of the regulations
+///		RegulationRecord regulations[]	grouped by the species, in the order of the text
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace BinaryModel {
+	const char MAGIC[] = "PMFB"; ///< The first four bytes of the file.
+	const uint32_t FORMAT_VERSION = 1; ///< Version of the layout, follows the magic.
+
+	struct ModelHeader {
+		char magic[4];
+		uint32_t version;
+		uint32_t string_count; ///< Names in the string table.
+		uint32_t input_count;
+		uint32_t species_count;
+		uint32_t regulation_count;
+		uint32_t positive_label; ///< Name of the label of the activating regulations.
+		uint32_t negative_label; ///< Name of the label of the other regulations.
+		uint64_t string_offsets; ///< Offsets of the sections from the start of the file.
+		uint64_t string_data;
+		uint64_t inputs;
+		uint64_t species;
+		uint64_t regulations;
+		uint64_t file_size;
+	};
+	static_assert(sizeof(ModelHeader) == 80, "The header must have no padding.");
+
+	struct SpecieRecord {
+		uint32_t name;
+		uint32_t first_regulation; ///< Index of its first regulation.
+		uint32_t regulation_count;
+		uint32_t reserved; ///< Zero, pads the record to the alignment.
+	};
+
+	struct RegulationRecord {
+		uint32_t source; ///< Name of the regulator.
+		uint32_t positive; ///< 1 for the positive label, 0 for the negative one.
+	};
+
+	// Formats the model in the binary format into the output.
+	inline void formatModel(const SifGraph & graph, const string & pos_cons, const string & neg_cons, OutputBuffer & output) {
+		BinaryFormat::StringTable strings;
+		vector<uint32_t> inputs;
+		for (const uint32_t input : graph.inputs)
+			inputs.push_back(strings.add(graph.nodes.name(input)));
+		vector<SpecieRecord> species;
+		vector<RegulationRecord> regulations;
+		for (const uint32_t specie : graph.species) {
+			species.push_back({ strings.add(graph.nodes.name(specie)), static_cast<uint32_t>(regulations.size()), static_cast<uint32_t>(graph.regulatorCount(specie)), 0 });
+			for (const uint32_t regul : crange(graph.offsets[specie], graph.offsets[specie + 1]))
+				regulations.push_back({ strings.add(graph.nodes.name(graph.sources[regul])), graph.positive[regul] ? 1u : 0u });
+		}
+
+		ModelHeader header{};
+		memcpy(header.magic, MAGIC, 4);
+		header.version = FORMAT_VERSION;
+		header.positive_label = strings.add(pos_cons);
+		header.negative_label = strings.add(neg_cons);
+		header.string_count = strings.size();
+		header.input_count = static_cast<uint32_t>(inputs.size());
+		header.species_count = static_cast<uint32_t>(species.size());
+		header.regulation_count = static_cast<uint32_t>(regulations.size());
+		header.string_offsets = BinaryFormat::aligned(sizeof(ModelHeader));
+		header.string_data = BinaryFormat::aligned(header.string_offsets + strings.offsetsSize());
+		header.inputs = BinaryFormat::aligned(header.string_data + strings.dataSize());
+		header.species = BinaryFormat::aligned(header.inputs + inputs.size() * sizeof(uint32_t));
+		header.regulations = BinaryFormat::aligned(header.species + species.size() * sizeof(SpecieRecord));
+		header.file_size = header.regulations + regulations.size() * sizeof(RegulationRecord);
+
+		output.reserve(header.file_size);
+		BinaryFormat::append(output, &header, 1);
+		strings.write(output, header.string_offsets, header.string_data);
+		BinaryFormat::padTo(output, header.inputs);
+		BinaryFormat::append(output, inputs.data(), inputs.size());
+		BinaryFormat::padTo(output, header.species);
+		BinaryFormat::append(output, species.data(), species.size());
+		BinaryFormat::padTo(output, header.regulations);
+		BinaryFormat::append(output, regulations.data(), regulations.size());
+	}
+
+	// A model read from the binary format
+	struct Model {
+		SifGraph graph; ///< The network.
+		string positive_label; ///< Label of the activating regulations.
+		string negative_label; ///< Label of the other regulations.
+	};
+
+	// @return	the model in the binary content, every section is checked to be within the file
+	inline Model readModel(const string_view content, const string & file_name) {
+		const BinaryFormat::FileView file(content, file_name);
+		file.checkHeader(MAGIC, FORMAT_VERSION);
+		const ModelHeader header = file.read<ModelHeader>(0);
+		const vector<string> names = file.strings(header.string_offsets, header.string_data, header.string_count);
+		auto name = [&](const uint32_t string_no) -> const string & {
+			if (string_no >= names.size())
+				throw invalid_argument("The binary file \"" + file_name + "\" is damaged, a name is out of the string table.\n");
+			return names[string_no];
+		};
+
+		// The graph is built again from the edges, the inputs and the order of the species come out the same
+		NodeTable nodes;
+		vector<Edge> edges;
+		const SpecieRecord * species = file.section<SpecieRecord>(header.species, header.species_count);
+		const RegulationRecord * regulations = file.section<RegulationRecord>(header.regulations, header.regulation_count);
+		for (const SpecieRecord & specie : boost::make_iterator_range(species, species + header.species_count)) {
+			const uint32_t target = nodes.intern(name(specie.name));
+			if (specie.first_regulation > header.regulation_count || specie.regulation_count > header.regulation_count - specie.first_regulation)
+				throw invalid_argument("The binary file \"" + file_name + "\" is damaged, the regulations of a specie are out of bounds.\n");
+			for (const uint32_t regul : crange(specie.first_regulation, specie.first_regulation + specie.regulation_count))
+				edges.push_back({ nodes.intern(name(regulations[regul].source)), target, regulations[regul].positive != 0 });
+		}
+
+		return Model{ buildGraph(move(nodes), edges), name(header.positive_label), name(header.negative_label) };
+	}
+}
@@ -9,81 +9,52 @@
 #include "../general/common_functions.hpp"
 
 #include "program_options.hpp"
-
-struct Regul {
-	string source;
-	string target;
-	string label;
-};
-
-void outputModel(const vector<Regul> & regulations, const set<string> & inputs, const string & filename) {
-	fstream output(filename, ios::out);
-	output << "<NETWORK>" << endl;
-
-	for (const string & input : inputs) {
-		output << "    <INPUT name=\"" << input << "\" />" << endl;
-	}
-
-	string last_specie;
-	for (const Regul & regul : regulations) {
-		bool new_specie = (regul.target != last_specie);
-		// If there was a predecessor, finish him
-		if (new_specie && !last_specie.empty())
-			output << "    </SPECIE>" << endl;
-		if (new_specie)
-			output << "    <SPECIE name=\"" << regul.target << "\">" << endl;
-			
-		output << "        <REGUL source=\"" << regul.source << "\" label=\"" << regul.label << "\" />" << endl;
-			
-		
-		
-		last_specie = regul.target;
-	}
-	
-	// Finish the last
-	output << "    </SPECIE>" << endl;	
-	output << "</NETWORK>" << endl;
-}
+#include "sif_conversion.hpp"
+#include "../general/batch.hpp"
+#include "../general/server.hpp"
+#include "../general/allocation_hooks.hpp"
 
 int main(int argc, char ** argv) {
 	try {
 		bpo::variables_map program_options = parseProgramOptions(argc, argv);
-		bfs::path sif_file(program_options["SIF"].as<string>());
-		bfs::path pmf_file(sif_file.parent_path().string() + sif_file.stem().string() + MODEL_EXTENSION);
 
-		// Hardcode setup
-		bool observable = true;
-		string pos_cons = observable ? "ActivatingOnly" : "NotInhibiting";
-		string neg_cons = observable ? "InhibitingOnly" : "NotActivating";
-
-		vector<Regul> regulations;
-
-		// Read input
-		fstream input_file(sif_file.string(), ios::in);
-		Regul temporary;
-		string label;
-		set<string> sources, targets;
-		while (input_file >> temporary.source && input_file >> label && input_file >> temporary.target) {
-			temporary.label = label == "1" ? pos_cons : neg_cons;
-			regulations.emplace_back(temporary);
-			sources.insert(temporary.source);
-			targets.insert(temporary.target);
+		const ModelSettings settings = getSettings(program_options);
+		Profiler::enabled = program_options["profile"].as<bool>();
+		int exit_code = 0;
+
+		// Resident, each request is parsed on the worker threads
+		if (program_options.count("serve")) {
+			Server::serve(program_options["serve"].as<string>(), SIF_EXTENSION, [&](const bfs::path & sif_file) {
+				convertFile(sif_file, settings);
+			});
+			if (Profiler::enabled)
+				cerr << Profiler::report.toJson("SifToPmf");
+			return 0;
 		}
 
-		// Add self-loops on inputs
-		set<string> inputs;
-		set_difference(begin(sources), end(sources), begin(targets), end(targets), inserter(inputs, inputs.begin()));
-
-		// Sort by target
-		sort(begin(regulations), end(regulations), [](const Regul & A, const Regul & B) {
-			return (A.target < B.target);
-		});
+		// A batch is converted file by file on the worker threads, a single file is parsed on them
+		const string input = program_options["SIF"].as<string>();
+
+		Profiler::Stage total("total");
+		if (Batch::isBatch(input)) {
+			ModelSettings file_settings = settings;
+			file_settings.thread_count = 1;
+			const size_t failed = Batch::convertAll(Batch::expandInputs(input, SIF_EXTENSION), settings.thread_count, [&file_settings](const bfs::path & sif_file) {
+				convertFile(sif_file, file_settings);
+			});
+			exit_code = failed == 0 ? 0 : 1;
+		}
+		else {
+			convertFile(bfs::path{ input }, settings);
+		}
+		total.stop();
 
-		// output to the file
-		outputModel(regulations, inputs, pmf_file.string());
+		if (Profiler::enabled)
+			cerr << Profiler::report.toJson("SifToPmf");
+		return exit_code;
 	}
 	catch (exception & e) {
 		cerr << "An exception thrown: " << e.what() << endl;
 	}
 	return 0;
-}
\ No newline at end of file
+}
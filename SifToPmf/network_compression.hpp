@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "sif_graph.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Compression of the network before it is written, the parametrization space of a specie grows exponentially with its regulators.
+/// The passes work on the edges in the order of the file and keep the order of the regulators of each target:
+///		duplicates	an edge with the same source, target and label as an earlier one is dropped
+///		dead ends	the edges into nodes that cannot reach any of the outputs (or the kept nodes) are dropped, only if some outputs are given
+///		chains		a node with a single regulator A and a single target B (A -> X -> B) is replaced by the edge A -> B, activating iff
+///					both the edges have the same label; a chain that would duplicate an existing edge A -> B of the opposite label is kept
+/// The outputs and the kept nodes are never removed. A node is removed when it loses all its edges.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace NetworkCompression {
+	// Settings of the compression
+	struct CompressionSettings {
+		bool enabled = false; ///< The network is compressed at all.
+		vector<string> outputs; ///< Names of the measured nodes, the other nodes must reach one of them.
+		vector<string> kept; ///< Names of further nodes that are never removed (e.g. the stimulated and the inhibited ones).
+	};
+
+	// What a single pass removed
+	struct PassReport {
+		string pass; ///< Name of the pass.
+		size_t removed_nodes; ///< Nodes that lost all their edges.
+		size_t removed_edges; ///< Edges dropped, a collapsed chain counts as one.
+	};
+
+	// The edges being compressed, each with a flag if it is still there
+	class EdgeSet {
+		vector<Edge> & edges; ///< The edges, an edge of a collapsed chain reuses the slot of the edge into the target.
+		vector<bool> alive; ///< The edges that were not dropped.
+		vector<vector<size_t>> in_edges; ///< Slots of the edges into each node, including the dropped ones.
+		vector<vector<size_t>> out_edges; ///< Slots of the edges out of each node, including the dropped and the redirected ones.
+		vector<size_t> in_degree; ///< Number of the edges into each node that are there.
+		vector<size_t> out_degree; ///< Number of the edges out of each node that are there.
+		unordered_map<uint64_t, size_t> slot_of_edge; ///< (source, target, label) of each edge that is there -> its slot.
+
+		// @return	the key of the edge in the slot_of_edge
+		static inline uint64_t key(const uint32_t source, const uint32_t target, const bool positive) {
+			return (static_cast<uint64_t>(source) << 33) | (static_cast<uint64_t>(target) << 1) | (positive ? 1u : 0u);
+		}
+
+	public:
+		EdgeSet(vector<Edge> & _edges, const size_t node_count) : edges(_edges), alive(_edges.size(), true), in_edges(node_count), out_edges(node_count),
+				in_degree(node_count, 0), out_degree(node_count, 0) {
+			for (const size_t slot : cscope(edges)) {
+				in_edges[edges[slot].target].push_back(slot);
+				out_edges[edges[slot].source].push_back(slot);
+				in_degree[edges[slot].target]++;
+				out_degree[edges[slot].source]++;
+			}
+		}
+
+		NO_COPY_SHORT(EdgeSet)
+
+		inline bool isAlive(const size_t slot) const {
+			return alive[slot];
+		}
+
+		inline size_t inDegree(const uint32_t node) const {
+			return in_degree[node];
+		}
+
+		inline size_t outDegree(const uint32_t node) const {
+			return out_degree[node];
+		}
+
+		// @return	slots of the edges into the node, including the dropped ones
+		inline const vector<size_t> & into(const uint32_t node) const {
+			return in_edges[node];
+		}
+
+		// @return	slots of the edges out of the node, including the dropped and the redirected ones
+		inline const vector<size_t> & outOf(const uint32_t node) const {
+			return out_edges[node];
+		}
+
+		// @return	the slot of the edge that is there, edges.size() if there is none
+		inline size_t find(const uint32_t source, const uint32_t target, const bool positive) const {
+			const auto known = slot_of_edge.find(key(source, target, positive));
+			return known == slot_of_edge.end() ? edges.size() : known->second;
+		}
+
+		// Records the edge as the first one of its kind, @return	false if an earlier one is there
+		inline bool registerEdge(const size_t slot) {
+			return slot_of_edge.emplace(key(edges[slot].source, edges[slot].target, edges[slot].positive), slot).second;
+		}
+
+		// Drops the edge.
+		inline void drop(const size_t slot) {
+			const Edge & edge = edges[slot];
+			const auto known = slot_of_edge.find(key(edge.source, edge.target, edge.positive));
+			if (known != slot_of_edge.end() && known->second == slot)
+				slot_of_edge.erase(known);
+			alive[slot] = false;
+			in_degree[edge.target]--;
+			out_degree[edge.source]--;
+		}
+
+		// Replaces the edge in the slot by the edge from the source, keeping its target and its position.
+		inline void redirect(const size_t slot, const uint32_t source, const bool positive) {
+			drop(slot);
+			edges[slot].source = source;
+			edges[slot].positive = positive;
+			alive[slot] = true;
+			out_edges[source].push_back(slot);
+			in_degree[edges[slot].target]++;
+			out_degree[source]++;
+			registerEdge(slot);
+		}
+
+		// @return	number of the nodes with an edge
+		size_t connectedCount() const {
+			size_t result = 0;
+			for (const size_t node : cscope(in_degree))
+				result += (in_degree[node] + out_degree[node]) > 0;
+			return result;
+		}
+
+		// @return	number of the edges that are there
+		size_t edgeCount() const {
+			return static_cast<size_t>(count(begin(alive), end(alive), true));
+		}
+
+		// Removes the dropped edges, the others keep their order.
+		void compact() {
+			size_t kept = 0;
+			for (const size_t slot : cscope(edges))
+				if (alive[slot])
+					edges[kept++] = edges[slot];
+			edges.resize(kept);
+		}
+	};
+
+	// @return	the IDs of the nodes of the names, the names that are not in the network are skipped
+	inline vector<uint32_t> findNodes(const vector<string> & names, const NodeTable & nodes) {
+		unordered_map<string_view, uint32_t> ids;
+		for (const uint32_t node : crange(static_cast<uint32_t>(nodes.size())))
+			ids.emplace(nodes.name(node), node);
+		vector<uint32_t> result;
+		for (const string & name : names) {
+			const auto known = ids.find(name);
+			if (known != ids.end())
+				result.push_back(known->second);
+		}
+		return result;
+	}
+
+	// Drops the edges that repeat an earlier one.
+	inline void removeDuplicates(EdgeSet & edges, const size_t edge_count) {
+		for (const size_t slot : crange(edge_count))
+			if (!edges.registerEdge(slot))
+				edges.drop(slot);
+	}
+
+	// Drops the edges into the nodes from which none of the protected nodes (the outputs and the kept ones) can be reached.
+	inline void removeDeadEnds(EdgeSet & edges, const vector<Edge> & edge_list, const boost::dynamic_bitset<> & protected_nodes) {
+		// Backwards from the protected nodes
+		boost::dynamic_bitset<> reaches = protected_nodes;
+		vector<uint32_t> stack;
+		for (size_t node = protected_nodes.find_first(); node != protected_nodes.npos; node = protected_nodes.find_next(node))
+			stack.push_back(static_cast<uint32_t>(node));
+		while (!stack.empty()) {
+			const uint32_t node = stack.back();
+			stack.pop_back();
+			for (const size_t slot : edges.into(node)) {
+				const uint32_t source = edge_list[slot].source;
+				if (edges.isAlive(slot) && !reaches.test(source)) {
+					reaches.set(source);
+					stack.push_back(source);
+				}
+			}
+		}
+
+		for (const size_t slot : cscope(edge_list))
+			if (edges.isAlive(slot) && !reaches.test(edge_list[slot].target))
+				edges.drop(slot);
+	}
+
+	// Replaces the nodes with a single regulator and a single target by a single edge, until there are none.
+	inline void collapseChains(EdgeSet & edges, const vector<Edge> & edge_list, const boost::dynamic_bitset<> & protected_nodes, const size_t node_count) {
+		// @return	the slot of the single edge of the node that is there, a redirected edge stays in the list of its former source
+		auto single = [&edges, &edge_list](const vector<size_t> & slots, const uint32_t node, const bool outgoing) {
+			return *find_if(begin(slots), end(slots), [&](const size_t slot) {
+				return edges.isAlive(slot) && (!outgoing || edge_list[slot].source == node);
+			});
+		};
+
+		vector<uint32_t> pending(node_count);
+		iota(pending.rbegin(), pending.rend(), 0);
+		while (!pending.empty()) {
+			const uint32_t node = pending.back();
+			pending.pop_back();
+			if (protected_nodes.test(node) || edges.inDegree(node) != 1 || edges.outDegree(node) != 1)
+				continue;
+
+			const size_t in_slot = single(edges.into(node), node, false);
+			const size_t out_slot = single(edges.outOf(node), node, true);
+			const uint32_t source = edge_list[in_slot].source;
+			const uint32_t target = edge_list[out_slot].target;
+			if (source == node || target == node)
+				continue;
+			const bool positive = edge_list[in_slot].positive == edge_list[out_slot].positive;
+			if (edges.find(source, target, !positive) != edge_list.size())
+				continue;
+
+			// The edge into the target takes the place of the chain, or the chain goes if the same edge is already there
+			edges.drop(in_slot);
+			if (edges.find(source, target, positive) != edge_list.size()) {
+				edges.drop(out_slot);
+				pending.push_back(source);
+				pending.push_back(target);
+			}
+			else {
+				edges.redirect(out_slot, source, positive);
+			}
+		}
+	}
+
+	/**
+	 * @brief Compresses the network by the passes in the order duplicates, dead ends, chains.
+	 * @param[in] nodes	names of the nodes, to find the outputs and the kept nodes
+	 * @param[in,out] edge_list	the edges in the order of the file, the edges that remain keep their order
+	 * @return	what each pass removed
+	 */
+	inline vector<PassReport> compressNetwork(const NodeTable & nodes, vector<Edge> & edge_list, const CompressionSettings & settings) {
+		const size_t node_count = nodes.size();
+		const vector<uint32_t> outputs = findNodes(settings.outputs, nodes);
+		boost::dynamic_bitset<> protected_nodes(node_count);
+		for (const uint32_t node : outputs)
+			protected_nodes.set(node);
+		for (const uint32_t node : findNodes(settings.kept, nodes))
+			protected_nodes.set(node);
+
+		EdgeSet edges(edge_list, node_count);
+		vector<PassReport> result;
+		auto run = [&](const string & pass, const function<void()> & compress) {
+			const size_t nodes_before = edges.connectedCount(), edges_before = edges.edgeCount();
+			compress();
+			result.push_back({ pass, nodes_before - edges.connectedCount(), edges_before - edges.edgeCount() });
+		};
+
+		run("duplicates", [&]() { removeDuplicates(edges, edge_list.size()); });
+		if (!outputs.empty())
+			run("dead_ends", [&]() { removeDeadEnds(edges, edge_list, protected_nodes); });
+		run("chains", [&]() { collapseChains(edges, edge_list, protected_nodes, node_count); });
+
+		edges.compact();
+		return result;
+	}
+}
@@ -7,7 +7,7 @@
  */
 #pragma once
 
-#include "../general/common_functions.hpp"
+#include "sif_conversion.hpp"
 
 /* Parse the program options - if help or version is required, terminate the program immediatelly. */
 bpo::variables_map parseProgramOptions(int argc, char ** argv) {
@@ -18,10 +18,24 @@ bpo::variables_map parseProgramOptions(int argc, char ** argv) {
 	visible.add_options()
 		("help,h", "display help")
 		("version,v", "display version")
+		("threads", bpo::value<size_t>()->default_value(1), "number of worker threads parsing the file, or converting the files of a batch")
+		("cache", bpo::value<string>()->default_value(""), "directory of the conversion cache, an input converted before with the same content is skipped")
+		("compress", bpo::bool_switch(),
+		"compress the network before writing it: merge duplicate edges, remove the nodes that cannot reach an output, collapse linear chains (what each pass removed goes to the standard error)")
+		("outputs", bpo::value<string>()->default_value(""), "comma-separated measured nodes for --compress, they are kept and the other nodes must reach one of them")
+		("keep", bpo::value<string>()->default_value(""), "comma-separated nodes --compress must not remove, e.g. the stimulated and the inhibited ones")
+		("memory-limit", bpo::value<size_t>()->default_value(0),
+		"megabytes of memory the conversion of a file may use, a larger file is sorted through temporary files instead (0 for no limit)")
+		("binary", bpo::bool_switch(), ("write the model in the binary format (" + BINARY_MODEL_EXTENSION + "), convertible back to the text by binaryToText").c_str())
+		("output-compression", bpo::value<string>()->default_value("none"),
+		("compress the written model by none, gzip (" + GZIP_EXTENSION + " appended) or zstd (" + ZSTD_EXTENSION + "), a compressed input is recognized by its extension").c_str())
+		("serve", bpo::value<string>(),
+		"stay resident and convert the inputs sent as lines to the Unix socket at the given path, or to the standard input for -")
+		("profile", bpo::bool_switch(), "print the wall time, allocations and peak memory of each stage of the conversion as JSON to the standard error")
 		;
 	bpo::options_description invisible;
 	invisible.add_options()
-		("SIF", bpo::value<string>()->required(), ("SIF file " + SIF_EXTENSION + " suffix").c_str())
+		("SIF", bpo::value<string>(), ("SIF file " + SIF_EXTENSION + " suffix, a directory, a glob pattern or @manifest").c_str())
 		;
 	bpo::options_description all;
 	all.add(visible).add(invisible);
@@ -31,6 +45,7 @@ bpo::variables_map parseProgramOptions(int argc, char ** argv) {
 	if (result.count("help")) {
 		cout << "SifToPmf filename";
 		cout << "    filename: input graph in the SIF format.";
+		cout << " Batch: a directory (all its " << SIF_EXTENSION << " files), a glob pattern or @manifest (a file with one path per line).";
 		cout << visible << "\n";
 		exit(0);
 	}
@@ -41,6 +56,25 @@ bpo::variables_map parseProgramOptions(int argc, char ** argv) {
 	}
 
 	bpo::notify(result);
+	if (!result.count("SIF") && !result.count("serve"))
+		throw invalid_argument("No input given, the SIF file or --serve is required.\n");
 
 	return result;
-}
\ No newline at end of file
+}
+
+// @return	the non-empty names in the comma-separated list
+vector<string> splitNames(const string & list) {
+	vector<string> result;
+	alg::split(result, list, boost::is_any_of(","));
+	for (string & name : result)
+		alg::trim(name);
+	result.erase(remove(begin(result), end(result), ""), end(result));
+	return result;
+}
+
+// @return	the settings of the conversion given by the program options
+ModelSettings getSettings(const bpo::variables_map & po) {
+	NetworkCompression::CompressionSettings compression{ po["compress"].as<bool>(), splitNames(po["outputs"].as<string>()), splitNames(po["keep"].as<string>()) };
+	return ModelSettings{ po["threads"].as<size_t>(), po["cache"].as<string>(), po["memory-limit"].as<size_t>() << 20, move(compression),
+		po["binary"].as<bool>(), CompressedStreams::parseCodec(po["output-compression"].as<string>()) };
+}
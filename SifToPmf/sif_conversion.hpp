@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "sif_parser.hpp"
+#include "sif_external.hpp"
+#include "network_compression.hpp"
+#include "binary_model.hpp"
+#include "../general/output_buffer.hpp"
+#include "../general/profiler.hpp"
+#include "../general/conversion_cache.hpp"
+
+const size_t MEMORY_PER_INPUT_BYTE = 8; ///< Memory of the conversion in memory per byte of the input (the content, the names, the edges and the text).
+
+// Settings of the conversion
+struct ModelSettings {
+	size_t thread_count; ///< Number of worker threads parsing the file.
+	string cache_dir; ///< Directory of the conversion cache, empty if the cache is not used.
+	size_t memory_limit; ///< Bytes the conversion may use, a larger file is converted through temporary files. 0 for no limit.
+	NetworkCompression::CompressionSettings compression; ///< How the network is compressed before it is written.
+	bool binary; ///< The model is written in the binary format.
+	CompressedStreams::Codec output_codec; ///< Compression of the written model.
+};
+
+// @return	the expected size of the model text, used to preallocate the output
+inline size_t estimateModelSize(const SifGraph & graph) {
+	size_t result = strlen("<NETWORK>\n</NETWORK>\n");
+	for (const uint32_t input : graph.inputs)
+		result += graph.nodes.name(input).size() + strlen("    <INPUT name=\"\" />\n");
+	for (const uint32_t specie : graph.species)
+		result += graph.nodes.name(specie).size() + strlen("    <SPECIE name=\"\">\n    </SPECIE>\n");
+	for (const uint32_t source : graph.sources)
+		result += graph.nodes.name(source).size() + strlen("        <REGUL source=\"\" label=\"ActivatingOnly\" />\n");
+	return result;
+}
+
+// Formats the model text into the output
+inline void formatModel(const SifGraph & graph, const string & pos_cons, const string & neg_cons, OutputBuffer & output) {
+	output.reserve(estimateModelSize(graph));
+	output << "<NETWORK>\n";
+
+	for (const uint32_t input : graph.inputs) {
+		output << "    <INPUT name=\"" << graph.nodes.name(input) << "\" />\n";
+	}
+
+	// Species by name, each with its regulators
+	for (const uint32_t specie : graph.species) {
+		output << "    <SPECIE name=\"" << graph.nodes.name(specie) << "\">\n";
+		for (const uint32_t regul : crange(graph.offsets[specie], graph.offsets[specie + 1]))
+			output << "        <REGUL source=\"" << graph.nodes.name(graph.sources[regul]) << "\" label=\"" << (graph.positive[regul] ? pos_cons : neg_cons) << "\" />\n";
+		output << "    </SPECIE>\n";
+	}
+
+	output << "</NETWORK>\n";
+}
+
+// Writes the model to the file
+inline void outputModel(const SifGraph & graph, const string & pos_cons, const string & neg_cons, const string & filename, const bool binary = false) {
+	OutputBuffer output;
+	if (binary)
+		BinaryModel::formatModel(graph, pos_cons, neg_cons, output);
+	else
+		formatModel(graph, pos_cons, neg_cons, output);
+	output.writeToFile(filename);
+}
+
+// Hardcode setup - all the edges are observable and monotonic
+const bool OBSERVABLE = true;
+const string POSITIVE_LABEL = OBSERVABLE ? "ActivatingOnly" : "NotInhibiting"; ///< Label of the edges with the label 1.
+const string NEGATIVE_LABEL = OBSERVABLE ? "InhibitingOnly" : "NotActivating"; ///< Label of the other edges.
+
+/**
+ * @brief Reads the graph of the SIF content.
+ * @param[in] thread_count	number of threads parsing the content
+ * @param[in] compression	how the network is compressed before the graph is built
+ * @param[out] report	if given, receives what each pass of the compression removed
+ * @return	the graph
+ */
+inline SifGraph readGraph(const string_view content, const size_t thread_count, const NetworkCompression::CompressionSettings & compression = {},
+		vector<NetworkCompression::PassReport> * report = nullptr) {
+	// The names are interned into IDs
+	Profiler::Stage parsing("parse");
+	NodeTable nodes;
+	vector<Edge> edges = SifParser::parse(content, thread_count, nodes);
+	parsing.stop();
+
+	if (compression.enabled) {
+		Profiler::Stage compressing("compress");
+		vector<NetworkCompression::PassReport> passes = NetworkCompression::compressNetwork(nodes, edges, compression);
+		if (report)
+			*report = move(passes);
+	}
+
+	// Group by target, find the inputs
+	Profiler::Stage building("build_graph");
+	return buildGraph(move(nodes), edges);
+}
+
+// @return	true iff the conversion of the file in memory would not fit into the memory limit, the size of a compressed file is estimated from its headers
+inline bool needsExternal(const bfs::path & sif_file, const ModelSettings & settings) {
+	return settings.memory_limit != 0
+		&& CompressedStreams::estimatePlainSize(sif_file, settings.memory_limit / MEMORY_PER_INPUT_BYTE) * MEMORY_PER_INPUT_BYTE > settings.memory_limit;
+}
+
+// Converts a SIF graph into a model file next to it, the file is parsed on the given number of threads. With a cache directory, an unchanged input is skipped.
+inline void convertFile(const bfs::path & sif_file, const ModelSettings & settings) {
+	const bfs::path plain_file = CompressedStreams::plainPath(sif_file);
+	const bfs::path pmf_file = CompressedStreams::compressedPath(plain_file.parent_path() / (plain_file.stem().string() + (settings.binary ? BINARY_MODEL_EXTENSION : MODEL_EXTENSION)),
+		settings.output_codec);
+
+	// Read input, a compressed one is decompressed only when it is converted in memory
+	Profiler::Stage reading("read");
+	const InputBuffer stored = InputBuffer::map(sif_file);
+	reading.stop();
+
+	optional<CacheEntry> cache;
+	string file_key;
+	if (!settings.cache_dir.empty()) {
+		Profiler::Stage checking("cache");
+		ContentHash hash;
+		hash.add(VERSION).add(stored.view()).add(POSITIVE_LABEL).add(NEGATIVE_LABEL).add(static_cast<uint64_t>(settings.compression.enabled))
+			.add(static_cast<uint64_t>(settings.binary)).add(static_cast<uint64_t>(settings.output_codec));
+		for (const string & name : settings.compression.outputs)
+			hash.add(name);
+		hash.add(static_cast<uint64_t>(settings.compression.outputs.size()));
+		for (const string & name : settings.compression.kept)
+			hash.add(name);
+		file_key = hash.hex();
+		cache = CacheEntry::load(settings.cache_dir, sif_file);
+		if (cache->upToDate(file_key))
+			return;
+	}
+
+	// A file too large for the memory is streamed through sorted temporary runs, the output is the same
+	if (needsExternal(sif_file, settings)) {
+		if (settings.compression.enabled || settings.binary)
+			throw invalid_argument("The compression and the binary format need the whole network in memory, the file \"" + sif_file.string() + "\" exceeds the memory limit.\n");
+		SifExternal::convertFile(sif_file, pmf_file, settings.memory_limit, POSITIVE_LABEL, NEGATIVE_LABEL);
+	}
+	else {
+		const InputBuffer input = InputBuffer::decompressed(stored, sif_file);
+		vector<NetworkCompression::PassReport> report;
+		const SifGraph graph = readGraph(input.view(), settings.thread_count, settings.compression, &report);
+		for (const NetworkCompression::PassReport & pass : report)
+			cerr << sif_file.string() << ": " << pass.pass << " removed " << pass.removed_nodes << " nodes and " << pass.removed_edges << " edges\n";
+
+		// output to the file
+		Profiler::Stage writing("write");
+		outputModel(graph, POSITIVE_LABEL, NEGATIVE_LABEL, pmf_file.string(), settings.binary);
+	}
+
+	if (cache) {
+		cache->setFileKey(file_key);
+		cache->setOutput(pmf_file.string(), file_key);
+		cache->save();
+	}
+}
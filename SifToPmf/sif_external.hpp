@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "sif_parser.hpp"
+#include "../general/external_sort.hpp"
+#include "../general/output_buffer.hpp"
+#include "../general/profiler.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Conversion of SIF files larger than the memory. The file is read in blocks, each is parsed by SifParser::parseChunk, and nothing is
+/// interned globally - the records carry the names. The edges are externally sorted by (target name, position in the file), the names by
+/// themselves with the roles they have (source, target). The model is then written in two streaming passes: the merged names give the
+/// inputs (the names that are sources and never targets) in the order of the names, the merged edges give the species with their regulators.
+/// The output is the same as of the conversion in memory.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace SifExternal {
+	const size_t READ_BLOCK_SIZE = 1 << 20; ///< Bytes of the file parsed at once, a block is extended to the end of its last line.
+	const size_t WRITE_BLOCK_SIZE = 1 << 20; ///< Bytes of the model formatted before they are appended to the file.
+	const size_t MIN_SORT_BUDGET = 1 << 20; ///< The least memory of each of the sorters, however low the limit is.
+
+	enum Role : uint8_t { Source = 1, Target = 2 };
+
+	// A single regulation, ordered by the target and then by the position in the file
+	struct EdgeRecord {
+		string target; ///< Name of the regulated node.
+		uint64_t position; ///< Number of the edge in the file.
+		string source; ///< Name of the regulator.
+		bool positive; ///< True for the label 1, false otherwise.
+
+		inline bool operator<(const EdgeRecord & other) const {
+			const int order = target.compare(other.target);
+			return order != 0 ? order < 0 : position < other.position;
+		}
+
+		inline size_t bytes() const {
+			return sizeof(EdgeRecord) + target.size() + source.size();
+		}
+
+		inline void write(ostream & output) const {
+			ExternalSort::writeString(output, target);
+			output.write(reinterpret_cast<const char *>(&position), sizeof(position));
+			ExternalSort::writeString(output, source);
+			output.put(positive ? 1 : 0);
+		}
+
+		inline bool read(istream & input) {
+			char label = 0;
+			if (!ExternalSort::readString(input, target) || !input.read(reinterpret_cast<char *>(&position), sizeof(position))
+					|| !ExternalSort::readString(input, source) || !input.get(label))
+				return false;
+			positive = label != 0;
+			return true;
+		}
+	};
+
+	// A name with the roles it has in a part of the file, ordered by the name
+	struct NameRecord {
+		string name; ///< Name of the node.
+		uint8_t roles; ///< Bits of the Role values.
+
+		inline bool operator<(const NameRecord & other) const {
+			return name < other.name;
+		}
+
+		inline size_t bytes() const {
+			return sizeof(NameRecord) + name.size();
+		}
+
+		inline void write(ostream & output) const {
+			ExternalSort::writeString(output, name);
+			output.put(static_cast<char>(roles));
+		}
+
+		inline bool read(istream & input) {
+			char bits = 0;
+			if (!ExternalSort::readString(input, name) || !input.get(bits))
+				return false;
+			roles = static_cast<uint8_t>(bits);
+			return true;
+		}
+	};
+
+	// Passes the file to the consumer in blocks of whole lines, each parsed on its own.
+	template<typename ConsumerType>
+	void forEachBlock(const bfs::path & sif_file, ConsumerType consume) {
+		ExternalSort::forEachLineBlock(sif_file, READ_BLOCK_SIZE, [&consume](const string_view block) {
+			consume(SifParser::parseChunk(block));
+		});
+	}
+
+	/**
+	 * @brief Converts the SIF file into the model file with the given amount of memory for the records, the rest goes to temporary files.
+	 * @param[in] memory_limit	bytes of the records held in memory, the memory of the whole conversion is a few blocks more
+	 */
+	inline void convertFile(const bfs::path & sif_file, const bfs::path & pmf_file, const size_t memory_limit, const string & pos_cons, const string & neg_cons) {
+		ExternalSort::TemporaryDirectory directory;
+		const size_t budget = max(memory_limit / 2, MIN_SORT_BUDGET);
+		ExternalSort::Sorter<EdgeRecord> edges(directory, budget);
+		ExternalSort::Sorter<NameRecord> names(directory, budget / 4);
+
+		// Sorted runs of the edges and of the names, the names of a block are unique within it
+		Profiler::Stage spilling("spill");
+		uint64_t position = 0;
+		forEachBlock(sif_file, [&](const SifParser::ParsedChunk & chunk) {
+			vector<uint8_t> roles(chunk.names.size(), 0);
+			for (const Edge & edge : chunk.edges) {
+				roles[edge.source] |= Source;
+				roles[edge.target] |= Target;
+				edges.add(EdgeRecord{ string{ chunk.names[edge.target] }, position++, string{ chunk.names[edge.source] }, edge.positive });
+			}
+			for (const size_t name_no : cscope(chunk.names))
+				names.add(NameRecord{ string{ chunk.names[name_no] }, roles[name_no] });
+		});
+		spilling.stop();
+
+		OutputBuffer output(WRITE_BLOCK_SIZE);
+		bios::filtering_ostream file;
+		CompressedStreams::openOutput(file, pmf_file);
+		auto flushFull = [&output, &file]() {
+			if (output.str().size() >= WRITE_BLOCK_SIZE)
+				output.flushTo(file);
+		};
+		output << "<NETWORK>\n";
+
+		// The inputs, the roles of a name from all the blocks are joined
+		Profiler::Stage merging_inputs("merge_inputs");
+		string name;
+		uint8_t roles = 0;
+		auto finishName = [&]() {
+			if (roles == Source)
+				output << "    <INPUT name=\"" << name << "\" />\n";
+			flushFull();
+		};
+		names.merge([&](const NameRecord & record) {
+			if (record.name != name) {
+				finishName();
+				name = record.name;
+				roles = 0;
+			}
+			roles |= record.roles;
+		});
+		finishName();
+		merging_inputs.stop();
+
+		// Species by name, each with its regulators
+		Profiler::Stage merging_species("merge_species");
+		string specie;
+		bool open = false;
+		edges.merge([&](const EdgeRecord & record) {
+			if (!open || record.target != specie) {
+				if (open)
+					output << "    </SPECIE>\n";
+				specie = record.target;
+				open = true;
+				output << "    <SPECIE name=\"" << specie << "\">\n";
+			}
+			output << "        <REGUL source=\"" << record.source << "\" label=\"" << (record.positive ? pos_cons : neg_cons) << "\" />\n";
+			flushFull();
+		});
+		if (open)
+			output << "    </SPECIE>\n";
+
+		output << "</NETWORK>\n";
+		output.flushTo(file);
+		if (!file.flush())
+			throw runtime_error("Could not write the file \"" + pmf_file.string() + "\".\n");
+		file.reset();
+	}
+}
@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "../general/common_functions.hpp"
+
+// Names of the nodes interned into dense IDs, assigned in the order of the first appearance.
+class NodeTable {
+	deque<string> names; ///< Name of each node by its ID, a deque so that the names never move.
+	unordered_map<string_view, uint32_t> ids; ///< Name -> ID, the keys view the names.
+
+public:
+	NodeTable() = default;
+	NO_COPY_SHORT(NodeTable)
+	DEFAULT_MOVE(NodeTable)
+
+	// @return	the ID of the node, a new one if the name was not seen before
+	inline uint32_t intern(const string_view name) {
+		const auto known = ids.find(name);
+		if (known != ids.end())
+			return known->second;
+
+		const uint32_t id = static_cast<uint32_t>(names.size());
+		names.emplace_back(name);
+		ids.emplace(names.back(), id);
+		return id;
+	}
+
+	// @return	the name of the node
+	inline const string & name(const uint32_t id) const {
+		return names[id];
+	}
+
+	// @return	number of the nodes
+	inline size_t size() const {
+		return names.size();
+	}
+};
+
+// A single regulation as read from the file
+struct Edge {
+	uint32_t source; ///< ID of the regulator.
+	uint32_t target; ///< ID of the regulated node.
+	bool positive; ///< True for the label 1, false otherwise.
+};
+
+// The regulatory graph with the edges grouped by their targets in the compressed sparse row layout.
+struct SifGraph {
+	NodeTable nodes; ///< Names of the nodes.
+	vector<uint32_t> offsets; ///< Regulations of the node t are [offsets[t], offsets[t + 1]), one entry per node plus one.
+	vector<uint32_t> sources; ///< Regulator of each regulation, grouped by target, in the input order within a group.
+	vector<bool> positive; ///< Label of each regulation, in the same order.
+	vector<uint32_t> inputs; ///< Nodes that regulate but are not regulated, ordered by name.
+	vector<uint32_t> species; ///< Nodes that are regulated, ordered by name.
+
+	// @return	number of regulations of the node
+	inline size_t regulatorCount(const uint32_t target) const {
+		return offsets[target + 1] - offsets[target];
+	}
+};
+
+// @return	the IDs ordered by the names of the nodes
+inline vector<uint32_t> sortByName(vector<uint32_t> ids, const NodeTable & nodes) {
+	sort(begin(ids), end(ids), [&nodes](const uint32_t A, const uint32_t B) {
+		return nodes.name(A) < nodes.name(B);
+	});
+	return ids;
+}
+
+// @return	the graph with the edges grouped by target by a counting sort, the order of the edges of a target is preserved
+inline SifGraph buildGraph(NodeTable nodes, const vector<Edge> & edges) {
+	SifGraph graph;
+	const size_t node_count = nodes.size();
+
+	// Count the regulations of each target, prefix sums are then the starts of the groups
+	graph.offsets.assign(node_count + 1, 0);
+	for (const Edge & edge : edges)
+		graph.offsets[edge.target + 1]++;
+	for (const size_t node : crange<size_t>(1, node_count + 1))
+		graph.offsets[node] += graph.offsets[node - 1];
+
+	graph.sources.resize(edges.size());
+	graph.positive.resize(edges.size());
+	vector<uint32_t> next(begin(graph.offsets), end(graph.offsets) - 1);
+	for (const Edge & edge : edges) {
+		const uint32_t position = next[edge.target]++;
+		graph.sources[position] = edge.source;
+		graph.positive[position] = edge.positive;
+	}
+
+	// Inputs are the sources that are not targets
+	boost::dynamic_bitset<> is_target(node_count), is_source(node_count);
+	for (const Edge & edge : edges) {
+		is_target.set(edge.target);
+		is_source.set(edge.source);
+	}
+	vector<uint32_t> inputs, species;
+	for (const uint32_t node : crange(static_cast<uint32_t>(node_count))) {
+		if (is_target.test(node))
+			species.push_back(node);
+		else if (is_source.test(node))
+			inputs.push_back(node);
+	}
+	graph.inputs = sortByName(move(inputs), nodes);
+	graph.species = sortByName(move(species), nodes);
+
+	graph.nodes = move(nodes);
+	return graph;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "sif_graph.hpp"
+#include "../general/input_buffer.hpp"
+#include "../general/thread_pool.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Parallel parsing of a SIF file held in memory. The content is split into chunks at line ends, each chunk is tokenized by its own thread
+/// with its own table of names (views into the content), the tables are then merged in the order of the chunks. The IDs and the order of the
+/// edges are thus the same as if the file was read sequentially.
+///
+/// Each line is "source label target [target ...]", lines with fewer than three tokens are skipped.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace SifParser {
+	const size_t CHUNKS_PER_THREAD = 4; ///< More chunks than threads so that the work stealing can balance uneven chunks.
+
+	// Nodes and edges of a single chunk, the IDs are local to the chunk
+	struct ParsedChunk {
+		vector<string_view> names; ///< Names of the nodes by their local ID, views into the content.
+		vector<Edge> edges; ///< The edges in the order of the chunk.
+	};
+
+	// @return	true for the characters that separate tokens on a line
+	inline bool isBlank(const char character) {
+		return character == ' ' || character == '\t' || character == '\r' || character == '\v' || character == '\f';
+	}
+
+	// @return	the nodes and the edges of the lines in the chunk
+	inline ParsedChunk parseChunk(const string_view chunk) {
+		ParsedChunk result;
+		unordered_map<string_view, uint32_t> local_ids;
+		auto intern = [&result, &local_ids](const string_view name) {
+			const auto inserted = local_ids.emplace(name, static_cast<uint32_t>(result.names.size()));
+			if (inserted.second)
+				result.names.push_back(name);
+			return inserted.first->second;
+		};
+
+		vector<string_view> tokens;
+		size_t position = 0;
+		while (position < chunk.size()) {
+			const size_t line_end = min(chunk.find('\n', position), chunk.size());
+
+			// Split the line on blanks
+			tokens.clear();
+			while (position < line_end) {
+				while (position < line_end && isBlank(chunk[position]))
+					position++;
+				const size_t token_begin = position;
+				while (position < line_end && !isBlank(chunk[position]))
+					position++;
+				if (position > token_begin)
+					tokens.push_back(chunk.substr(token_begin, position - token_begin));
+			}
+			position = line_end + 1;
+
+			if (tokens.size() < 3)
+				continue;
+			const uint32_t source = intern(tokens[0]);
+			const bool positive = tokens[1] == "1";
+			for (const size_t target_no : crange<size_t>(2, tokens.size()))
+				result.edges.push_back({ source, intern(tokens[target_no]), positive });
+		}
+
+		return result;
+	}
+
+	// @return	the content split into the given number of parts, each ends right after a line end (or at the end of the content)
+	inline vector<string_view> splitAtLines(const string_view content, const size_t chunk_count) {
+		vector<string_view> chunks;
+		size_t chunk_begin = 0;
+		for (const size_t chunk_no : crange<size_t>(1, chunk_count + 1)) {
+			size_t chunk_end = content.size() * chunk_no / chunk_count;
+			if (chunk_end < content.size()) {
+				chunk_end = content.find('\n', max(chunk_end, chunk_begin));
+				chunk_end = chunk_end == string_view::npos ? content.size() : chunk_end + 1;
+			}
+			if (chunk_end > chunk_begin)
+				chunks.push_back(content.substr(chunk_begin, chunk_end - chunk_begin));
+			chunk_begin = max(chunk_begin, chunk_end);
+		}
+		return chunks;
+	}
+
+	/**
+	 * @brief Parses the SIF content on the given number of threads.
+	 * @param[in] content	the whole SIF file
+	 * @param[in] thread_count	number of worker threads, 1 parses in the calling thread
+	 * @param[out] nodes	table receiving the names of the nodes
+	 * @return	the edges in the order of the file, with the IDs from the nodes table
+	 */
+	inline vector<Edge> parse(const string_view content, const size_t thread_count, NodeTable & nodes) {
+		const vector<string_view> chunks = splitAtLines(content, thread_count <= 1 ? 1 : thread_count * CHUNKS_PER_THREAD);
+		vector<ParsedChunk> parsed(chunks.size());
+		forEachParallel(thread_count, vrange(chunks.size()), [&chunks, &parsed](const size_t chunk_no) {
+			parsed[chunk_no] = parseChunk(chunks[chunk_no]);
+		});
+
+		// Merge in the order of the chunks, the local IDs are in the order of appearance, so the global ones are as well
+		size_t edge_count = 0;
+		for (const ParsedChunk & chunk : parsed)
+			edge_count += chunk.edges.size();
+		vector<Edge> edges;
+		edges.reserve(edge_count);
+		vector<uint32_t> global_ids;
+		for (ParsedChunk & chunk : parsed) {
+			global_ids.clear();
+			for (const string_view name : chunk.names)
+				global_ids.push_back(nodes.intern(name));
+			for (const Edge & edge : chunk.edges)
+				edges.push_back({ global_ids[edge.source], global_ids[edge.target], edge.positive });
+			chunk = ParsedChunk{};
+		}
+
+		return edges;
+	}
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "../general/common_functions.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Generators of synthetic input files for the benchmarks. The same parameters and seed always give the same file.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace Generators {
+	// Shape of a synthetic MIDAS file
+	struct MidasParameters {
+		size_t rows; ///< Number of data rows.
+		size_t stimuli; ///< Number of stimulated TR columns.
+		size_t inhibitors; ///< Number of inhibited TR columns, the setups are all the combinations of the TR columns.
+		size_t measured; ///< Number of DV columns.
+		size_t time_points; ///< Number of distinct times in the DA column.
+		double missing_rate; ///< Probability that a DV cell is NaN.
+		size_t cycle_length; ///< If non-zero, each setup cycles through a loop of that many states, otherwise the values are random.
+		unsigned seed; ///< Seed of the random generator.
+	};
+
+	// Shape of a synthetic SIF graph
+	struct SifParameters {
+		size_t nodes; ///< Number of nodes.
+		size_t edges; ///< Number of edges.
+		double degree_exponent; ///< 0 gives uniformly chosen targets, larger values give a power-law in-degree distribution.
+		unsigned seed; ///< Seed of the random generator.
+	};
+
+	// @return	the content of a MIDAS file with the given shape
+	inline string generateMidas(const MidasParameters & parameters) {
+		mt19937 generator(parameters.seed);
+		uniform_real_distribution<double> uniform(0., 1.);
+		const size_t TR_count = parameters.stimuli + parameters.inhibitors;
+		const size_t setup_count = size_t{ 1 } << min<size_t>(TR_count, 20);
+
+		string result = "TR:Bench:CellLine";
+		for (const size_t stimulus : crange(parameters.stimuli))
+			result += ",TR:S" + to_string(stimulus);
+		for (const size_t inhibitor : crange(parameters.inhibitors))
+			result += ",TR:I" + to_string(inhibitor) + "i";
+		result += ",DA:ALL";
+		for (const size_t measured : crange(parameters.measured))
+			result += ",DV:P" + to_string(measured);
+		result += "\n";
+
+		// Loops of binarized states for each setup, if the series are cyclic
+		vector<vector<vector<bool>>> loops(parameters.cycle_length > 0 ? setup_count : 0);
+		for (auto & loop : loops) {
+			loop.resize(parameters.cycle_length, vector<bool>(parameters.measured));
+			for (auto & state : loop)
+				for (size_t value_no : cscope(state))
+					state[value_no] = uniform(generator) < 0.5;
+		}
+
+		vector<size_t> rows_of_setup(setup_count, 0);
+		for (size_t row = 0; row < parameters.rows; row++) {
+			const size_t setup = generator() % setup_count;
+			const size_t step = rows_of_setup[setup]++;
+
+			result += "1";
+			for (const size_t TR_no : crange(TR_count))
+				result += ((setup >> (TR_no % 20)) & 1) ? ",1" : ",0";
+			result += "," + to_string(step % max<size_t>(1, parameters.time_points) * 10);
+			for (const size_t measured : crange(parameters.measured)) {
+				if (uniform(generator) < parameters.missing_rate) {
+					result += ",NaN";
+				}
+				else if (!loops.empty()) {
+					result += loops[setup][step % parameters.cycle_length][measured] ? ",0.95" : ",0.05";
+				}
+				else {
+					char digits[16];
+					snprintf(digits, sizeof(digits), ",%.3f", uniform(generator));
+					result += digits;
+				}
+			}
+			result += "\n";
+		}
+
+		return result;
+	}
+
+	// @return	the content of a SIF file with the given shape
+	inline string generateSif(const SifParameters & parameters) {
+		mt19937 generator(parameters.seed);
+		vector<double> weights(parameters.nodes);
+		for (const size_t node : cscope(weights))
+			weights[node] = 1. / pow(static_cast<double>(node + 1), parameters.degree_exponent);
+		discrete_distribution<size_t> pick_target(begin(weights), end(weights));
+		uniform_int_distribution<size_t> pick_source(0, max<size_t>(1, parameters.nodes) - 1);
+
+		string result;
+		for (size_t edge = 0; edge < parameters.edges; edge++) {
+			result += "N" + to_string(pick_source(generator));
+			result += (generator() & 1) ? " 1 " : " -1 ";
+			result += "N" + to_string(pick_target(generator)) + "\n";
+		}
+
+		return result;
+	}
+}
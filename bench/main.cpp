@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#include "generators.hpp"
+#include "../MidasToPpf/midas_conversion.hpp"
+#include "../SifToPmf/sif_conversion.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Benchmarks of the stages of both tools on synthetic inputs. Each benchmark is run the given number of times,
+/// the results are written as JSON so that runs before and after a change can be compared by a script.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+using namespace Generators;
+
+// Timing of a single benchmark
+struct BenchResult {
+	string name; ///< Tool and stage, e.g. "midas/getData".
+	string scenario; ///< Name of the generated input.
+	string parameters; ///< The parameters of the input as a JSON object.
+	size_t input_bytes; ///< Size of the generated input file.
+	vector<double> seconds; ///< Wall time of each repetition.
+};
+
+// @return	the parameters as a JSON object
+string toJson(const MidasParameters & parameters) {
+	return "{\"rows\": " + to_string(parameters.rows) + ", \"stimuli\": " + to_string(parameters.stimuli) + ", \"inhibitors\": " + to_string(parameters.inhibitors)
+		+ ", \"measured\": " + to_string(parameters.measured) + ", \"time_points\": " + to_string(parameters.time_points)
+		+ ", \"missing_rate\": " + to_string(parameters.missing_rate) + ", \"cycle_length\": " + to_string(parameters.cycle_length)
+		+ ", \"seed\": " + to_string(parameters.seed) + "}";
+}
+
+// @return	the parameters as a JSON object
+string toJson(const SifParameters & parameters) {
+	return "{\"nodes\": " + to_string(parameters.nodes) + ", \"edges\": " + to_string(parameters.edges)
+		+ ", \"degree_exponent\": " + to_string(parameters.degree_exponent) + ", \"seed\": " + to_string(parameters.seed) + "}";
+}
+
+// @return	the wall time of each of the repetitions of the work, the setup is run before each repetition and is not measured
+template<typename SetupType, typename WorkType>
+vector<double> measure(const size_t repetitions, SetupType setup, WorkType work) {
+	vector<double> result;
+	for (size_t repetition = 0; repetition < repetitions; repetition++) {
+		setup();
+		const auto start = chrono::steady_clock::now();
+		work();
+		result.push_back(chrono::duration<double>(chrono::steady_clock::now() - start).count());
+	}
+	return result;
+}
+
+// @return	the content as a buffer that owns it
+InputBuffer toBuffer(const string & content) {
+	return InputBuffer::own(vector<char>(begin(content), end(content)));
+}
+
+// Writes the content to the file
+void writeInput(const bfs::path & path, const string & content) {
+	ofstream file(path.string(), ios::out | ios::binary);
+	file.write(content.data(), content.size());
+	if (!file)
+		throw runtime_error("Could not write the file \"" + path.string() + "\".\n");
+}
+
+// Runs the benchmarks of the MIDAS conversion stages on a single scenario
+void benchMidas(const string & scenario, const MidasParameters & parameters, const size_t repetitions, const bfs::path & work_dir, vector<BenchResult> & results) {
+	const string content = generateMidas(parameters);
+	const ConversionSettings settings{ 0.1, 1, "", false, 0, false, false, CompressedStreams::Codec::None, 0 };
+	auto record = [&](const string & stage, vector<double> seconds) {
+		results.push_back({ "midas/" + stage, scenario, toJson(parameters), content.size(), move(seconds) });
+	};
+	auto no_setup = []() {};
+
+	const HeaderSchema schema = compileSchema(getHeader(content));
+	unique_ptr<MidasTable> data;
+	record("getData", measure(repetitions, no_setup, [&]() {
+		data = make_unique<MidasTable>(getData(toBuffer(content), schema));
+	}));
+
+	ExprGroups expr_groups;
+	record("getExprGroups", measure(repetitions, no_setup, [&]() {
+		expr_groups = getExprGroups(schema.TR_columns, *data);
+	}));
+
+	vector<vector<uint8_t>> codes;
+	record("binarizeColumns", measure(repetitions, no_setup, [&]() {
+		codes = binarizeColumns(schema.DV_columns, *data, settings.error, 1);
+	}));
+
+	vector<PackedSeries> measurements(expr_groups.groups.size());
+	record("getMeasurements", measure(repetitions, no_setup, [&]() {
+		for (const size_t expr_no : cscope(expr_groups.groups))
+			measurements[expr_no] = getMeasurements(schema.DV_columns, codes, expr_groups.rowsOf(expr_no));
+	}));
+
+	// The reductions work in place, so each repetition starts from a copy of the measurements made outside of the timing
+	vector<Experiment> experiments(expr_groups.groups.size());
+	auto copy_measurements = [&]() {
+		for (const size_t expr_no : cscope(experiments))
+			experiments[expr_no].series = measurements[expr_no];
+	};
+	record("removeRepetitive", measure(repetitions, copy_measurements, [&]() {
+		for (Experiment & expr : experiments) {
+			removeRedundant(expr.series);
+			removeRepetitive(expr.series);
+		}
+	}));
+
+	for (const size_t expr_no : cscope(experiments)) {
+		experiments[expr_no].inhibited = getAffected(schema.components, expr_groups.groups[expr_no].setup, CompData::Inhibited);
+		experiments[expr_no].stimulated = getAffected(schema.components, expr_groups.groups[expr_no].setup, CompData::Stimulated);
+		experiments[expr_no].measured = schema.measured;
+	}
+	size_t written = 0;
+	record("writeProperty", measure(repetitions, no_setup, [&]() {
+		for (const Experiment & expr : experiments) {
+			OutputBuffer output(estimatePropertySize(expr));
+			writeProperty(expr, output);
+			written += output.str().size();
+		}
+	}));
+
+	// The whole conversion including the file system, the outputs are removed before each repetition
+	const bfs::path scenario_dir = work_dir / ("midas_" + scenario);
+	const bfs::path input_path = scenario_dir / "bench.csv";
+	auto fresh_dir = [&]() {
+		bfs::remove_all(scenario_dir);
+		bfs::create_directories(scenario_dir);
+		writeInput(input_path, content);
+	};
+	record("convertFile", measure(repetitions, fresh_dir, [&]() {
+		SchemaCache schemas;
+		convertFile(input_path, settings, schemas);
+	}));
+	ConversionSettings container_settings = settings;
+	container_settings.container = true;
+	record("convertFile_container", measure(repetitions, fresh_dir, [&]() {
+		SchemaCache schemas;
+		convertFile(input_path, container_settings, schemas);
+	}));
+	ConversionSettings aggregate_settings = settings;
+	aggregate_settings.aggregate = true;
+	record("convertFile_aggregate", measure(repetitions, fresh_dir, [&]() {
+		SchemaCache schemas;
+		convertFile(input_path, aggregate_settings, schemas);
+	}));
+	// A limit below the size of the input, so that the file is converted partition by partition
+	ConversionSettings partitioned_settings = settings;
+	partitioned_settings.memory_limit = content.size();
+	record("convertFile_partitioned", measure(repetitions, fresh_dir, [&]() {
+		SchemaCache schemas;
+		convertFile(input_path, partitioned_settings, schemas);
+	}));
+	bfs::remove_all(scenario_dir);
+}
+
+// Runs the benchmarks of the SIF conversion stages on a single scenario
+void benchSif(const string & scenario, const SifParameters & parameters, const size_t repetitions, const bfs::path & work_dir, vector<BenchResult> & results) {
+	const string content = generateSif(parameters);
+	auto record = [&](const string & stage, vector<double> seconds) {
+		results.push_back({ "sif/" + stage, scenario, toJson(parameters), content.size(), move(seconds) });
+	};
+
+	unique_ptr<NodeTable> nodes;
+	vector<Edge> edges;
+	record("parse", measure(repetitions, [&]() { nodes = make_unique<NodeTable>(); }, [&]() {
+		edges = SifParser::parse(content, 1, *nodes);
+	}));
+
+	// The graph takes the table over, so each repetition builds from its own copy of the parse
+	unique_ptr<SifGraph> graph;
+	record("buildGraph", measure(repetitions, [&]() {
+		nodes = make_unique<NodeTable>();
+		edges = SifParser::parse(content, 1, *nodes);
+	}, [&]() {
+		graph = make_unique<SifGraph>(buildGraph(move(*nodes), edges));
+	}));
+
+	// Duplicates and chains only, the generated graphs have no designated outputs
+	const NetworkCompression::CompressionSettings compression{ true, {}, {} };
+	record("compressNetwork", measure(repetitions, [&]() {
+		nodes = make_unique<NodeTable>();
+		edges = SifParser::parse(content, 1, *nodes);
+	}, [&]() {
+		NetworkCompression::compressNetwork(*nodes, edges, compression);
+	}));
+
+	record("formatModel", measure(repetitions, []() {}, [&]() {
+		OutputBuffer output;
+		formatModel(*graph, "ActivatingOnly", "InhibitingOnly", output);
+	}));
+
+	const bfs::path scenario_dir = work_dir / ("sif_" + scenario);
+	const bfs::path input_path = scenario_dir / "bench.sif";
+	auto fresh_dir = [&]() {
+		bfs::remove_all(scenario_dir);
+		bfs::create_directories(scenario_dir);
+		writeInput(input_path, content);
+	};
+	const ModelSettings settings{ 1, "", 0, {}, false, CompressedStreams::Codec::None };
+	record("convertFile", measure(repetitions, fresh_dir, [&]() {
+		convertFile(input_path, settings);
+	}));
+	// A limit below the size of the input forces the temporary runs
+	const ModelSettings external_settings{ 1, "", content.size(), {}, false, CompressedStreams::Codec::None };
+	record("convertFile_external", measure(repetitions, fresh_dir, [&]() {
+		convertFile(input_path, external_settings);
+	}));
+	bfs::remove_all(scenario_dir);
+}
+
+// @return	the results as a JSON document
+string resultsToJson(const vector<BenchResult> & results, const size_t repetitions, const double scale) {
+	string json = "{\n\t\"suite\": \"CNOAdapters\",\n\t\"repetitions\": " + to_string(repetitions) + ",\n\t\"scale\": " + to_string(scale) + ",\n\t\"results\": [";
+	for (const size_t result_no : cscope(results)) {
+		const BenchResult & result = results[result_no];
+		const double min_time = *min_element(begin(result.seconds), end(result.seconds));
+		const double max_time = *max_element(begin(result.seconds), end(result.seconds));
+		const double mean_time = accumulate(begin(result.seconds), end(result.seconds), 0.) / result.seconds.size();
+
+		json += result_no == 0 ? "\n" : ",\n";
+		json += "\t\t{\"benchmark\": \"" + result.name + "\", \"scenario\": \"" + result.scenario + "\", \"parameters\": " + result.parameters
+			+ ", \"input_bytes\": " + to_string(result.input_bytes) + ", \"min_seconds\": " + to_string(min_time) + ", \"mean_seconds\": " + to_string(mean_time)
+			+ ", \"max_seconds\": " + to_string(max_time) + ", \"megabytes_per_second\": " + to_string(min_time > 0. ? result.input_bytes / min_time / 1e6 : 0.) + "}";
+	}
+	json += "\n\t]\n}\n";
+	return json;
+}
+
+int main(int argc, char* argv[]) {
+	try {
+		bpo::options_description options{ "Options" };
+		options.add_options()
+			("help,h", "display help")
+			("repetitions,r", bpo::value<size_t>()->default_value(3), "number of runs of each benchmark")
+			("scale,s", bpo::value<double>()->default_value(1.), "multiplier of the sizes of the generated inputs")
+			("output,o", bpo::value<string>(), "file for the JSON results, standard output if not given")
+			;
+		bpo::variables_map po;
+		bpo::store(bpo::parse_command_line(argc, argv, options), po);
+		bpo::notify(po);
+		if (po.count("help")) {
+			cout << "Benchmarks of the CNOAdapters conversions on synthetic inputs.\n" << options << endl;
+			return 0;
+		}
+		const size_t repetitions = max<size_t>(1, po["repetitions"].as<size_t>());
+		const double scale = po["scale"].as<double>();
+		auto scaled = [scale](const size_t size) { return max<size_t>(1, static_cast<size_t>(size * scale)); };
+
+		const bfs::path work_dir = bfs::temp_directory_path() / bfs::unique_path("cnoadapters-bench-%%%%-%%%%");
+		bfs::create_directories(work_dir);
+		vector<BenchResult> results;
+
+		//                          rows                stimuli  inhibitors  measured    time_points  missing  cycle  seed
+		benchMidas("baseline", { scaled(20000), 3, 2, 20, 10, 0.05, 0, 1 }, repetitions, work_dir, results);
+		benchMidas("wide", { scaled(5000), 3, 2, 200, 10, 0.05, 0, 2 }, repetitions, work_dir, results);
+		benchMidas("many_setups", { scaled(20000), 6, 4, 20, 5, 0.05, 0, 3 }, repetitions, work_dir, results);
+		benchMidas("sparse", { scaled(20000), 3, 2, 20, 10, 0.5, 0, 4 }, repetitions, work_dir, results);
+		benchMidas("cyclic", { scaled(20000), 2, 1, 20, 1000, 0., 7, 5 }, repetitions, work_dir, results);
+
+		//                      nodes            edges            exponent  seed
+		benchSif("uniform", { scaled(20000), scaled(100000), 0., 6 }, repetitions, work_dir, results);
+		benchSif("power_law", { scaled(20000), scaled(100000), 1.2, 7 }, repetitions, work_dir, results);
+
+		bfs::remove_all(work_dir);
+
+		const string json = resultsToJson(results, repetitions, scale);
+		if (po.count("output")) {
+			OutputBuffer output;
+			output << json;
+			output.writeToFile(po["output"].as<string>());
+		}
+		else {
+			cout << json;
+		}
+	}
+	catch (exception & e) {
+		cerr << "An exception thrown: " << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
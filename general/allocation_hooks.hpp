@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+#include "profiler.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Replacement of the global operators new and delete that counts the allocations for the profiler. All the forms are replaced (single
+/// and array, aligned, nothrow), so every allocation is counted and freed by the matching function. The replacement must be defined exactly once
+/// in a program, so this file is included only by the file with main(). While the profiling is off, an allocation costs a single relaxed load more.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace AllocationHooks {
+	// @return	the memory of the size, null if there is none
+	inline void * allocate(const size_t size) {
+		if (Profiler::enabled.load(memory_order_relaxed))
+			Profiler::countAllocation(size);
+		return malloc(size == 0 ? 1 : size);
+	}
+
+	// @return	the memory of the size at the alignment, null if there is none
+	inline void * allocate(const size_t size, const align_val_t alignment) {
+		if (Profiler::enabled.load(memory_order_relaxed))
+			Profiler::countAllocation(size);
+		const size_t bytes = static_cast<size_t>(alignment);
+		return aligned_alloc(bytes, max<size_t>(1, (size + bytes - 1) / bytes) * bytes);
+	}
+
+	// Frees the memory of any of the forms. Not inlined, so that the compiler does not pair the free with the new of the caller.
+	[[gnu::noinline]] inline void release(void * memory) noexcept {
+		free(memory);
+	}
+
+	// @return	the allocated memory, bad_alloc is thrown if there is none
+	inline void * checked(void * memory) {
+		if (!memory)
+			throw bad_alloc();
+		return memory;
+	}
+}
+
+void * operator new(size_t size) {
+	return AllocationHooks::checked(AllocationHooks::allocate(size));
+}
+
+void * operator new[](size_t size) {
+	return AllocationHooks::checked(AllocationHooks::allocate(size));
+}
+
+void * operator new(size_t size, const nothrow_t &) noexcept {
+	return AllocationHooks::allocate(size);
+}
+
+void * operator new[](size_t size, const nothrow_t &) noexcept {
+	return AllocationHooks::allocate(size);
+}
+
+void * operator new(size_t size, align_val_t alignment) {
+	return AllocationHooks::checked(AllocationHooks::allocate(size, alignment));
+}
+
+void * operator new[](size_t size, align_val_t alignment) {
+	return AllocationHooks::checked(AllocationHooks::allocate(size, alignment));
+}
+
+void * operator new(size_t size, align_val_t alignment, const nothrow_t &) noexcept {
+	return AllocationHooks::allocate(size, alignment);
+}
+
+void * operator new[](size_t size, align_val_t alignment, const nothrow_t &) noexcept {
+	return AllocationHooks::allocate(size, alignment);
+}
+
+void operator delete(void * memory) noexcept {
+	AllocationHooks::release(memory);
+}
+
+void operator delete[](void * memory) noexcept {
+	AllocationHooks::release(memory);
+}
+
+void operator delete(void * memory, size_t) noexcept {
+	AllocationHooks::release(memory);
+}
+
+void operator delete[](void * memory, size_t) noexcept {
+	AllocationHooks::release(memory);
+}
+
+void operator delete(void * memory, const nothrow_t &) noexcept {
+	AllocationHooks::release(memory);
+}
+
+void operator delete[](void * memory, const nothrow_t &) noexcept {
+	AllocationHooks::release(memory);
+}
+
+void operator delete(void * memory, align_val_t) noexcept {
+	AllocationHooks::release(memory);
+}
+
+void operator delete[](void * memory, align_val_t) noexcept {
+	AllocationHooks::release(memory);
+}
+
+void operator delete(void * memory, size_t, align_val_t) noexcept {
+	AllocationHooks::release(memory);
+}
+
+void operator delete[](void * memory, size_t, align_val_t) noexcept {
+	AllocationHooks::release(memory);
+}
+
+void operator delete(void * memory, align_val_t, const nothrow_t &) noexcept {
+	AllocationHooks::release(memory);
+}
+
+void operator delete[](void * memory, align_val_t, const nothrow_t &) noexcept {
+	AllocationHooks::release(memory);
+}
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+#include "thread_pool.hpp"
+#include "compressed_streams.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Conversion of many input files within a single process. The input argument is a batch if it is
+///		- a directory: all the files with the extension of the tool in it,
+///		- a glob pattern: the files in the directory whose names match the pattern (*, ? and [...] in the file name only),
+///		- a manifest: @file, where the file lists one input path per line (empty lines and lines starting with # are skipped),
+///		  a relative path is relative to the directory of the manifest.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace Batch {
+	const char MANIFEST_PREFIX = '@'; ///< Marks an argument that names a manifest file.
+
+	// @return	true iff the name matches the pattern with the wildcards *, ? and [...]
+	inline bool matchesWildcard(const string_view pattern, const string_view name) {
+		if (pattern.empty())
+			return name.empty();
+
+		switch (pattern[0]) {
+		case '*':
+			for (const size_t skipped : crange(name.size() + 1))
+				if (matchesWildcard(pattern.substr(1), name.substr(skipped)))
+					return true;
+			return false;
+		case '?':
+			return !name.empty() && matchesWildcard(pattern.substr(1), name.substr(1));
+		case '[': {
+			const size_t class_end = pattern.find(']', 1);
+			if (class_end != string_view::npos) {
+				if (name.empty())
+					return false;
+				const bool negated = pattern.size() > 1 && pattern[1] == '!';
+				const string_view members = pattern.substr(negated ? 2 : 1, class_end - (negated ? 2 : 1));
+				bool found = false;
+				for (size_t member = 0; member < members.size(); member++) {
+					if (member + 2 < members.size() && members[member + 1] == '-') {
+						found |= members[member] <= name[0] && name[0] <= members[member + 2];
+						member += 2;
+					}
+					else {
+						found |= members[member] == name[0];
+					}
+				}
+				return found != negated && matchesWildcard(pattern.substr(class_end + 1), name.substr(1));
+			}
+			// An unterminated class is a plain character
+			[[fallthrough]];
+		}
+		default:
+			return !name.empty() && name[0] == pattern[0] && matchesWildcard(pattern.substr(1), name.substr(1));
+		}
+	}
+
+	// @return	true iff the name contains a wildcard
+	inline bool hasWildcard(const string & name) {
+		return name.find_first_of("*?[") != string::npos;
+	}
+
+	// @return	true iff the argument describes more input files rather than a single one, an existing file is never a batch
+	inline bool isBatch(const string & argument) {
+		if (bfs::is_regular_file(argument))
+			return false;
+		return (!argument.empty() && argument[0] == MANIFEST_PREFIX) || hasWildcard(argument) || bfs::is_directory(argument);
+	}
+
+	// @return	the input files described by the argument, the files from a directory or a pattern are sorted by name
+	inline vector<bfs::path> expandInputs(const string & argument, const string & extension) {
+		vector<bfs::path> result;
+
+		if (!argument.empty() && argument[0] == MANIFEST_PREFIX) {
+			const bfs::path manifest_path{ argument.substr(1) };
+			ifstream manifest(manifest_path.string());
+			if (!manifest)
+				throw invalid_argument("Can not open the manifest \"" + manifest_path.string() + "\".\n");
+			string line;
+			while (getline(manifest, line)) {
+				alg::trim(line);
+				if (line.empty() || line[0] == '#')
+					continue;
+				const bfs::path entry{ line };
+				result.push_back(entry.is_relative() ? manifest_path.parent_path() / entry : entry);
+			}
+			return result;
+		}
+
+		bfs::path directory{ argument };
+		string pattern = "*" + extension;
+		if (hasWildcard(argument)) {
+			directory = bfs::path{ argument }.parent_path();
+			pattern = bfs::path{ argument }.filename().string();
+			if (directory.empty())
+				directory = ".";
+		}
+		if (!bfs::is_directory(directory))
+			throw invalid_argument("Wrong directory \"" + directory.string() + "\".\n");
+
+		// The files of a directory are matched without the extension of their compression
+		const bool by_extension = !hasWildcard(argument);
+		for (const bfs::directory_entry & entry : bfs::directory_iterator(directory))
+			if (bfs::is_regular_file(entry.status()) && matchesWildcard(pattern, (by_extension ? CompressedStreams::plainPath(entry.path()) : entry.path()).filename().string()))
+				result.emplace_back(entry.path());
+		sort(begin(result), end(result));
+
+		return result;
+	}
+
+	/**
+	 * @brief Converts all the inputs on a pool of worker threads. A failure of a file does not stop the others, a summary of all the files is printed.
+	 * @param[in] inputs	the files to convert
+	 * @param[in] thread_count	number of worker threads
+	 * @param[in] convert	conversion of a single file, failures are reported by exceptions
+	 * @return	number of the files that failed
+	 */
+	template<typename ConvertType>
+	size_t convertAll(const vector<bfs::path> & inputs, const size_t thread_count, ConvertType convert) {
+		vector<string> failures(inputs.size());
+		vector<size_t> file_nos = vrange(inputs.size());
+		forEachParallel(thread_count, file_nos, [&](const size_t file_no) {
+			try {
+				convert(inputs[file_no]);
+			}
+			catch (exception & e) {
+				failures[file_no] = alg::trim_copy(string{ e.what() });
+				if (failures[file_no].empty())
+					failures[file_no] = "unknown error";
+			}
+		});
+
+		size_t failed = 0;
+		for (const size_t file_no : cscope(inputs)) {
+			if (failures[file_no].empty()) {
+				cout << "OK      " << inputs[file_no].string() << "\n";
+			}
+			else {
+				cout << "FAILED  " << inputs[file_no].string() << ": " << failures[file_no] << "\n";
+				failed++;
+			}
+		}
+		cout << "Converted " << inputs.size() - failed << " of " << inputs.size() << " files." << endl;
+
+		return failed;
+	}
+}
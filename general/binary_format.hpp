@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+#include "output_buffer.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Building blocks of the binary model (.pmfb) and property (.ppfb) formats. A file is a fixed header followed by sections, each starts
+/// at a multiple of ALIGNMENT bytes from the start of the file, so a consumer can map the file and use every section in place as an array
+/// of fixed-width records. The numbers are in the native byte order (little-endian on all the supported hosts).
+///
+/// The names are in a string table of two sections: uint32_t offsets[count + 1] into the data, and the data - the names one after another,
+/// each followed by a zero byte, so a name is also a C string. The records refer to the names by their index in the table.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace BinaryFormat {
+	const size_t ALIGNMENT = 8; ///< Every section starts at a multiple of this.
+
+	// @return	the offset rounded up to the alignment
+	inline uint64_t aligned(const uint64_t offset) {
+		return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+	}
+
+	// Appends the bytes of the values.
+	template<typename ValueType>
+	void append(OutputBuffer & output, const ValueType * values, const size_t count) {
+		static_assert(is_trivially_copyable<ValueType>::value, "Only plain records can be written.");
+		output << string_view(reinterpret_cast<const char *>(values), count * sizeof(ValueType));
+	}
+
+	// Pads the output with zeros to the offset.
+	inline void padTo(OutputBuffer & output, const uint64_t offset) {
+		while (output.str().size() < offset)
+			output << '\0';
+	}
+
+	// The names of a file, each stored once
+	class StringTable {
+		vector<uint32_t> offsets{ 0 }; ///< Start of each name in the data, plus the end.
+		string data; ///< The names, each followed by a zero byte.
+		unordered_map<string, uint32_t> index_of; ///< Name -> its index.
+
+	public:
+		// @return	the index of the name, added if it is not there yet
+		uint32_t add(const string & name) {
+			const auto inserted = index_of.emplace(name, static_cast<uint32_t>(offsets.size() - 1));
+			if (inserted.second) {
+				data.append(name).push_back('\0');
+				offsets.push_back(static_cast<uint32_t>(data.size()));
+			}
+			return inserted.first->second;
+		}
+
+		inline uint32_t size() const {
+			return static_cast<uint32_t>(offsets.size() - 1);
+		}
+
+		// @return	bytes of the offsets section
+		inline uint64_t offsetsSize() const {
+			return offsets.size() * sizeof(uint32_t);
+		}
+
+		// @return	bytes of the data section
+		inline uint64_t dataSize() const {
+			return data.size();
+		}
+
+		// Appends the two sections, each at its offset.
+		void write(OutputBuffer & output, const uint64_t offsets_offset, const uint64_t data_offset) const {
+			padTo(output, offsets_offset);
+			append(output, offsets.data(), offsets.size());
+			padTo(output, data_offset);
+			output << string_view(data);
+		}
+	};
+
+	// Read access to a binary file held in memory, every access is checked against the size of the file
+	class FileView {
+		string_view content; ///< The whole file.
+		string file_name; ///< For the messages.
+
+	public:
+		FileView(const string_view _content, string _file_name) : content(_content), file_name(move(_file_name)) {}
+
+		// @return	a copy of the record at the offset
+		template<typename ValueType>
+		ValueType read(const uint64_t offset) const {
+			ValueType result;
+			memcpy(&result, section<char>(offset, sizeof(ValueType)), sizeof(ValueType));
+			return result;
+		}
+
+		// @return	the section of the records at the offset, it must be within the file and aligned
+		template<typename ValueType>
+		const ValueType * section(const uint64_t offset, const uint64_t count) const {
+			if (offset > content.size() || count > (content.size() - offset) / sizeof(ValueType) || (sizeof(ValueType) > 1 && offset % ALIGNMENT != 0))
+				throw invalid_argument("The binary file \"" + file_name + "\" is damaged, a section is out of its bounds.\n");
+			return reinterpret_cast<const ValueType *>(content.data() + offset);
+		}
+
+		// @return	the names of the string table in the two sections
+		vector<string> strings(const uint64_t offsets_offset, const uint64_t data_offset, const uint32_t count) const {
+			const uint32_t * offsets = section<uint32_t>(offsets_offset, static_cast<uint64_t>(count) + 1);
+			const char * data = section<char>(data_offset, offsets[count]);
+			vector<string> result;
+			result.reserve(count);
+			for (const uint32_t string_no : crange(count)) {
+				if (offsets[string_no] >= offsets[string_no + 1])
+					throw invalid_argument("The binary file \"" + file_name + "\" is damaged, its string table is not ordered.\n");
+				result.emplace_back(data + offsets[string_no], offsets[string_no + 1] - offsets[string_no] - 1);
+			}
+			return result;
+		}
+
+		// Checks the magic bytes and the version at the start of the file.
+		void checkHeader(const char * magic, const uint32_t version) const {
+			if (content.size() < 8 || content.substr(0, 4) != string_view(magic, 4))
+				throw invalid_argument("The file \"" + file_name + "\" is not in the " + string(magic, 4) + " format.\n");
+			if (read<uint32_t>(4) != version)
+				throw invalid_argument("The file \"" + file_name + "\" is of an unsupported version of the " + string(magic, 4) + " format.\n");
+		}
+
+		// @return	true iff the file starts with the magic bytes
+		inline bool hasMagic(const char * magic) const {
+			return content.size() >= 4 && content.substr(0, 4) == string_view(magic, 4);
+		}
+
+		// @return	size of the file
+		inline size_t size() const {
+			return content.size();
+		}
+	};
+}
@@ -82,7 +82,7 @@ namespace CommonFunctions {
 	* @param[in,out] val  reference to value that will be increased
 	*/
 	template<>
-	void increase<bool>(bool & val) { val = true; }
+	inline void increase<bool>(bool & val) { val = true; }
 
 	/**
 	* @brief Iterates values from left to right if it is possible. If so, return true, otherwise return false.
@@ -107,7 +107,7 @@ namespace CommonFunctions {
 		return true;
 	}
 
-	vector<string> getAllMatches(const string & control_regex, string source, int n = 0) {
+	inline vector<string> getAllMatches(const string & control_regex, string source, int n = 0) {
 		vector<string> result;
 
 		smatch matches;
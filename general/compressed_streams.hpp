@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+#include "profiler.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Compressed inputs and outputs, the compression of a file is given by its last extension: GZIP_EXTENSION or ZSTD_EXTENSION.
+/// The format of the content is given by the extension before it (e.g. data.csv.gz is a gzipped MIDAS file). The content is decompressed
+/// while it is read and compressed while it is written, no uncompressed copy is ever stored.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace CompressedStreams {
+	enum class Codec { None, Gzip, Zstd };
+
+	const uintmax_t MAX_GZIP_RATIO = 1032; ///< Deflate expands the content at most this many times.
+	const uintmax_t MAX_ZSTD_RATIO = 1 << 15; ///< A zstd block of a repeated byte expands the content at most this many times.
+	const uintmax_t ZSTD_BLOCK_SIZE = 1 << 17; ///< The most content a zstd block holds.
+
+	// @return	the compression of the file by its extension
+	inline Codec codecOf(const bfs::path & path) {
+		const string extension = path.extension().string();
+		if (extension == GZIP_EXTENSION)
+			return Codec::Gzip;
+		if (extension == ZSTD_EXTENSION)
+			return Codec::Zstd;
+		return Codec::None;
+	}
+
+	// @return	the extension of the files compressed by the codec, empty for none
+	inline string extensionOf(const Codec codec) {
+		switch (codec) {
+		case Codec::Gzip:
+			return GZIP_EXTENSION;
+		case Codec::Zstd:
+			return ZSTD_EXTENSION;
+		default:
+			return "";
+		}
+	}
+
+	// @return	the codec of the name given in the options: none, gzip (gz) or zstd (zst)
+	inline Codec parseCodec(const string & name) {
+		if (name == "none")
+			return Codec::None;
+		if (name == "gzip" || name == "gz")
+			return Codec::Gzip;
+		if (name == "zstd" || name == "zst")
+			return Codec::Zstd;
+		throw invalid_argument("Unknown compression \"" + name + "\", use none, gzip or zstd.\n");
+	}
+
+	// @return	the path without the extension of its compression, e.g. data.csv for data.csv.gz
+	inline bfs::path plainPath(const bfs::path & path) {
+		return codecOf(path) == Codec::None ? path : path.parent_path() / path.stem();
+	}
+
+	// @return	the path with the extension of the codec appended
+	inline bfs::path compressedPath(const bfs::path & path, const Codec codec) {
+		return codec == Codec::None ? path : bfs::path{ path.string() + extensionOf(codec) };
+	}
+
+	// Adds the decompressor of the codec to the stream, nothing for none. Its source is pushed after it.
+	inline void pushDecompressor(bios::filtering_istream & input, const Codec codec) {
+		if (codec == Codec::Gzip)
+			input.push(bios::gzip_decompressor());
+		else if (codec == Codec::Zstd)
+			input.push(bios::zstd_decompressor());
+	}
+
+	// Adds the compressor of the codec to the stream, nothing for none. Its sink is pushed after it.
+	inline void pushCompressor(bios::filtering_ostream & output, const Codec codec) {
+		if (codec == Codec::Gzip)
+			output.push(bios::gzip_compressor());
+		else if (codec == Codec::Zstd)
+			output.push(bios::zstd_compressor());
+	}
+
+	// Opens the file for reading through the decompressor of its extension.
+	inline void openInput(bios::filtering_istream & input, const bfs::path & path) {
+		if (!bfs::exists(path))
+			throw invalid_argument("Wrong filename \"" + path.string() + "\".\n");
+		pushDecompressor(input, codecOf(path));
+		input.push(bios::file_source(path.string(), ios::in | ios::binary));
+		input.exceptions(ios::badbit);
+	}
+
+	// Opens the file for writing through the compressor of its extension, the file is replaced.
+	inline void openOutput(bios::filtering_ostream & output, const bfs::path & path) {
+		pushCompressor(output, codecOf(path));
+		const bios::file_sink file(path.string(), ios::out | ios::binary);
+		if (!file.is_open())
+			throw runtime_error("Could not write the file \"" + path.string() + "\".\n");
+		output.push(file);
+	}
+
+	// @return	the content decompressed by the codec
+	inline vector<char> decompress(const string_view content, const Codec codec, const string & file_name) {
+		Profiler::Stage decompressing("decompress");
+		vector<char> result;
+		try {
+			bios::filtering_istream input;
+			pushDecompressor(input, codec);
+			input.push(bios::array_source(content.data(), content.size()));
+			input.exceptions(ios::badbit);
+			bios::copy(input, bios::back_inserter(result));
+		}
+		catch (ios_base::failure & e) {
+			throw invalid_argument("The compressed file \"" + file_name + "\" is damaged: " + e.what() + "\n");
+		}
+		return result;
+	}
+
+	// Reads the bytes at the offset of the file. @return	false iff the file ends before them
+	inline bool readAt(ifstream & file, const uintmax_t offset, unsigned char * bytes, const size_t count) {
+		file.clear();
+		file.seekg(static_cast<streamoff>(offset));
+		file.read(reinterpret_cast<char *>(bytes), static_cast<streamsize>(count));
+		return file.gcount() == static_cast<streamsize>(count);
+	}
+
+	// @return	the little-endian number in the bytes
+	inline uint64_t littleEndian(const unsigned char * bytes, const size_t count) {
+		uint64_t result = 0;
+		for (size_t byte_no = count; byte_no > 0; byte_no--)
+			result = (result << 8) | bytes[byte_no - 1];
+		return result;
+	}
+
+	// @return	size of the content declared by the gzip trailer, none if the file is not gzip. The trailer holds the size of the last member modulo 2^32,
+	//			it is wrapped while it is below half of the file and the compression allows it. A file of several members (e.g. concatenated files) is underestimated.
+	inline optional<uintmax_t> gzipDeclaredSize(ifstream & file, const uintmax_t file_size) {
+		const uintmax_t WRAP = uintmax_t{ 1 } << 32;
+		unsigned char bytes[4];
+		if (file_size < 18 || !readAt(file, 0, bytes, 2) || bytes[0] != 0x1f || bytes[1] != 0x8b || !readAt(file, file_size - 4, bytes, 4))
+			return nullopt;
+		uintmax_t result = littleEndian(bytes, 4);
+		while (result < file_size / 2 && result + WRAP <= file_size * MAX_GZIP_RATIO)
+			result += WRAP;
+		return result;
+	}
+
+	// @return	size of the content of the zstd frames - the size a frame declares, else the most its blocks can hold; none if the frames are damaged
+	inline optional<uintmax_t> zstdDeclaredSize(ifstream & file, const uintmax_t file_size) {
+		const size_t DICTIONARY_BYTES[] = { 0, 1, 2, 4 };
+		unsigned char bytes[16];
+		uintmax_t offset = 0, result = 0;
+		while (offset < file_size) {
+			if (!readAt(file, offset, bytes, 8))
+				return nullopt;
+			// A skippable frame holds no content
+			const uint64_t magic = littleEndian(bytes, 4);
+			if ((magic & 0xFFFFFFF0u) == 0x184D2A50u) {
+				offset += 8 + littleEndian(bytes + 4, 4);
+				continue;
+			}
+			if (magic != 0xFD2FB528u)
+				return nullopt;
+
+			// The frame header: the descriptor, the window, the dictionary and the content size
+			const unsigned descriptor = bytes[4];
+			const bool single_segment = (descriptor & 0x20) != 0;
+			const size_t size_flag = descriptor >> 6;
+			const size_t size_bytes = size_flag == 0 ? (single_segment ? 1 : 0) : size_t{ 1 } << size_flag;
+			const size_t size_offset = 1 + (single_segment ? 0 : 1) + DICTIONARY_BYTES[descriptor & 3];
+			if (!readAt(file, offset + 4, bytes, size_offset + size_bytes))
+				return nullopt;
+			optional<uintmax_t> declared;
+			if (size_bytes > 0)
+				declared = littleEndian(bytes + size_offset, size_bytes) + (size_bytes == 2 ? 256 : 0);
+			offset += 4 + size_offset + size_bytes;
+
+			// The blocks: raw and repeated ones declare their content, a compressed one holds at most a full block
+			uintmax_t bound = 0;
+			for (bool last = false; !last;) {
+				if (!readAt(file, offset, bytes, 3))
+					return nullopt;
+				const uint64_t block = littleEndian(bytes, 3);
+				const uint64_t type = (block >> 1) & 3, size = block >> 3;
+				if (type == 3)
+					return nullopt;
+				last = (block & 1) != 0;
+				bound += type == 2 ? ZSTD_BLOCK_SIZE : size;
+				offset += 3 + (type == 1 ? 1 : size);
+			}
+			offset += (descriptor & 0x04) != 0 ? 4 : 0;
+			result += declared ? *declared : bound;
+		}
+		if (offset != file_size)
+			return nullopt;
+		return result;
+	}
+
+	// @return	size of the content of the file after the decompression, the content is streamed through and never held
+	inline uintmax_t plainSize(const bfs::path & path) {
+		if (codecOf(path) == Codec::None)
+			return bfs::file_size(path);
+
+		uintmax_t result = 0;
+		try {
+			bios::filtering_istream input;
+			openInput(input, path);
+			vector<char> block(1 << 20);
+			while (input) {
+				input.read(block.data(), block.size());
+				result += static_cast<uintmax_t>(input.gcount());
+			}
+		}
+		catch (ios_base::failure & e) {
+			throw invalid_argument("The compressed file \"" + path.string() + "\" is damaged: " + e.what() + "\n");
+		}
+		return result;
+	}
+
+	/**
+	 * @brief Estimates the size of the content of the file after the decompression from the sizes the file declares, without decompressing it.
+	 * A file that declares none is bounded by the highest ratio of its compression, only if that bound is over the limit the content is streamed through.
+	 * @param[in] limit	the size the caller compares with, a bound up to it suffices
+	 * @return	the size of the content, or an upper bound of it that is at most the limit
+	 */
+	inline uintmax_t estimatePlainSize(const bfs::path & path, const uintmax_t limit) {
+		const Codec codec = codecOf(path);
+		const uintmax_t file_size = bfs::file_size(path);
+		if (codec == Codec::None)
+			return file_size;
+
+		ifstream file(path.string(), ios::in | ios::binary);
+		const optional<uintmax_t> declared = codec == Codec::Gzip ? gzipDeclaredSize(file, file_size) : zstdDeclaredSize(file, file_size);
+		if (declared)
+			return *declared;
+		const uintmax_t ratio = codec == Codec::Gzip ? MAX_GZIP_RATIO : MAX_ZSTD_RATIO;
+		if (file_size <= limit / ratio)
+			return file_size * ratio;
+		return plainSize(path);
+	}
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+#include "common_functions.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file On-disk cache of the conversions. For each input file the cache directory holds an entry with the key of the content the outputs were
+/// produced from (a hash of the input and the options) and the key of each output file. A tool skips an input whose key did not change
+/// and whose outputs all still exist, and it skips writing an output whose own key did not change.
+///
+/// An entry is a text file named by the hash of the absolute path of the input:
+///		CNOAdapters cache 1
+///		input <path>
+///		key <hex>
+///		output <hex> <absolute path>
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const string CACHE_HEADER("CNOAdapters cache 1"); ///< First line of a cache entry, an entry with another one is ignored.
+const string CACHE_EXTENSION(".cache"); ///< Extension of the entries.
+
+// A 64-bit non-cryptographic hash of a sequence of values, used as a key of the content
+class ContentHash {
+	uint64_t state = 0x9E3779B97F4A7C15ull; ///< The hash so far.
+
+	inline void mix(const uint64_t word) {
+		state = (state ^ word) * 0xBF58476D1CE4E5B9ull;
+		state ^= state >> 31;
+	}
+
+public:
+	// Adds the bytes, eight at a time, followed by their count so that the boundaries of the values matter.
+	inline ContentHash & add(const string_view bytes) {
+		size_t position = 0;
+		for (; position + sizeof(uint64_t) <= bytes.size(); position += sizeof(uint64_t)) {
+			uint64_t word;
+			memcpy(&word, bytes.data() + position, sizeof(uint64_t));
+			mix(word);
+		}
+		uint64_t tail = 0;
+		if (position < bytes.size())
+			memcpy(&tail, bytes.data() + position, bytes.size() - position);
+		mix(tail);
+		mix(bytes.size());
+		return *this;
+	}
+
+	inline ContentHash & add(const uint64_t number) {
+		mix(number);
+		return *this;
+	}
+
+	inline ContentHash & add(const double number) {
+		uint64_t bits;
+		memcpy(&bits, &number, sizeof(bits));
+		mix(bits);
+		return *this;
+	}
+
+	// @return	the hash as 16 hexadecimal digits
+	inline string hex() const {
+		uint64_t result = state;
+		result = (result ^ (result >> 33)) * 0xFF51AFD7ED558CCDull;
+		result ^= result >> 33;
+		char digits[17];
+		snprintf(digits, sizeof(digits), "%016llx", static_cast<unsigned long long>(result));
+		return digits;
+	}
+};
+
+// The record of the last conversion of a single input file
+class CacheEntry {
+	bfs::path entry_path; ///< The file of the entry in the cache directory.
+	string input; ///< Absolute path of the input.
+	string file_key; ///< Key of the input and the options, empty if the input was never converted.
+	map<string, string> recorded_keys; ///< Absolute path of each output of the last conversion -> key of its content.
+	map<string, string> output_keys; ///< The same for the outputs of this conversion, only these are saved.
+
+	// @return	the absolute form of the path, the inputs and the outputs are recorded by it
+	static string absolutePath(const bfs::path & path) {
+		return bfs::absolute(path).lexically_normal().string();
+	}
+
+public:
+	/**
+	 * @brief Reads the entry of the input from the cache, an entry that is missing or damaged is empty.
+	 * @param[in] cache_dir	the cache directory, it is created when the entry is saved
+	 * @param[in] input_path	the converted file
+	 * @return	the entry of the input
+	 */
+	static CacheEntry load(const bfs::path & cache_dir, const bfs::path & input_path) {
+		CacheEntry result;
+		result.input = absolutePath(input_path);
+		result.entry_path = cache_dir / (ContentHash{}.add(result.input).hex() + CACHE_EXTENSION);
+
+		ifstream file(result.entry_path.string());
+		string line;
+		if (!getline(file, line) || line != CACHE_HEADER)
+			return result;
+		string file_key;
+		map<string, string> output_keys;
+		bool same_input = false;
+		while (getline(file, line)) {
+			const size_t key_end = line.find(' ');
+			if (key_end == string::npos)
+				return result;
+			const string tag = line.substr(0, key_end);
+			const string rest = line.substr(key_end + 1);
+			if (tag == "input") {
+				same_input = rest == result.input;
+			}
+			else if (tag == "key") {
+				file_key = rest;
+			}
+			else if (tag == "output") {
+				const size_t path_begin = rest.find(' ');
+				if (path_begin == string::npos)
+					return result;
+				output_keys[rest.substr(path_begin + 1)] = rest.substr(0, path_begin);
+			}
+		}
+		// Two inputs with the same hash of the path do not share the entry
+		if (same_input) {
+			result.file_key = move(file_key);
+			result.recorded_keys = move(output_keys);
+		}
+		return result;
+	}
+
+	// @return	true iff the input was converted with this key and all its outputs still exist
+	inline bool upToDate(const string & key) const {
+		return !file_key.empty() && file_key == key && all_of(begin(recorded_keys), end(recorded_keys), [](const pair<const string, string> & output) {
+			return bfs::exists(output.first);
+		});
+	}
+
+	// @return	true iff the output was written by the last conversion from the content with this key and it still exists
+	inline bool outputUpToDate(const string & output, const string & key) const {
+		const auto known = recorded_keys.find(absolutePath(output));
+		return known != recorded_keys.end() && known->second == key && bfs::exists(known->first);
+	}
+
+	// Records that the input with the key was converted.
+	inline void setFileKey(const string & key) {
+		file_key = key;
+	}
+
+	// Records the key of the content of the output, written or skipped by this conversion. The outputs of the last conversion that are not
+	// recorded again (e.g. of an experiment that is no longer in the input) are dropped from the entry.
+	inline void setOutput(const string & output, const string & key) {
+		output_keys[absolutePath(output)] = key;
+	}
+
+	// Writes the entry to the cache, through a temporary file so that a reader never sees a partial entry.
+	void save() const {
+		bfs::create_directories(entry_path.parent_path());
+		const bfs::path temporary = entry_path.parent_path() / bfs::unique_path("%%%%-%%%%-%%%%.tmp");
+		{
+			ofstream file(temporary.string());
+			file << CACHE_HEADER << "\ninput " << input << "\nkey " << file_key << "\n";
+			for (const auto & output : output_keys)
+				file << "output " << output.second << " " << output.first << "\n";
+			if (!file)
+				throw runtime_error("Could not write the cache entry \"" + temporary.string() + "\".\n");
+		}
+		bfs::rename(temporary, entry_path);
+	}
+};
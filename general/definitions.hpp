@@ -18,6 +18,24 @@
 #include <string>
 #include <algorithm>
 #include <map>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <string_view>
+#include <charconv>
+#include <chrono>
+#include <numeric>
+#include <cmath>
+#include <cstdio>
+#include <atomic>
+#include <new>
+#include <optional>
+#include <cstring>
+#include <queue>
 
 #include <boost/range/algorithm.hpp>
 #include <boost/range/counting_range.hpp>
@@ -25,6 +43,16 @@
 #include <boost/filesystem.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/dynamic_bitset.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/gzip.hpp>
+#include <boost/iostreams/filter/zstd.hpp>
+#include <boost/iostreams/copy.hpp>
 
 /*
  * Copyright (C) 2014 - Adam Streck
@@ -37,12 +65,18 @@ namespace bpo = boost::program_options;
 namespace rng = boost::range;
 namespace bfs = boost::filesystem;
 namespace alg = boost::algorithm;
+namespace bios = boost::iostreams;
 using namespace std;
 
 const string MIDAS_EXTENSION(".csv"); ///< MIDAS file format.
 const string SIF_EXTENSION(".sif"); ///< SIF graph file format.
 const string PROPERTY_EXTENSION(".ppf"); ///< Parsybone property format.
 const string MODEL_EXTENSION(".pmf"); ///< Parsybone model format.
+const string CONTAINER_EXTENSION(".ppfc"); ///< All the properties of a MIDAS file in a single indexed file.
+const string BINARY_PROPERTY_EXTENSION(".ppfb"); ///< Parsybone property in the binary format.
+const string BINARY_MODEL_EXTENSION(".pmfb"); ///< Parsybone model in the binary format.
+const string GZIP_EXTENSION(".gz"); ///< A file compressed by gzip, appended to the extension of its content.
+const string ZSTD_EXTENSION(".zst"); ///< A file compressed by zstd, appended to the extension of its content.
 const size_t INF = numeric_limits<size_t>::max();
 const string VERSION("1.0.2.0");
 
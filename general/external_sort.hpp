@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+#include "compressed_streams.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Sorting of more records than fit into the memory. The records are collected up to a budget of bytes, each full batch is sorted
+/// and written to a temporary file as a run, the runs are then merged by a k-way merge on a heap and streamed to a consumer.
+/// With more runs than MERGE_FAN_IN, groups of them are merged into longer runs first, so only a bounded number of files is open at once.
+///
+/// A record type provides:
+///		bool operator<(const Record &) const	the order, records that are equal come out in the order they were added
+///		size_t bytes() const					the memory the record takes
+///		void write(ostream &) const				appends the record to a run
+///		bool read(istream &)					reads the next record of a run, false at its end
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace ExternalSort {
+	const size_t MERGE_FAN_IN = 64; ///< Most runs merged at once.
+	const size_t RUN_BUFFER_SIZE = 1 << 16; ///< Size of the buffer of each open run file.
+
+	// Appends the string to the binary stream, prefixed by its length.
+	inline void writeString(ostream & output, const string_view text) {
+		const uint32_t length = static_cast<uint32_t>(text.size());
+		output.write(reinterpret_cast<const char *>(&length), sizeof(length));
+		output.write(text.data(), text.size());
+	}
+
+	// Reads a string written by writeString. @return	false if the stream ended
+	inline bool readString(istream & input, string & text) {
+		uint32_t length;
+		if (!input.read(reinterpret_cast<char *>(&length), sizeof(length)))
+			return false;
+		text.resize(length);
+		return static_cast<bool>(input.read(&text[0], length));
+	}
+
+	/**
+	 * @brief Passes the file to the consumer in blocks of whole lines, so that a file larger than the memory can be parsed block by block.
+	 * @param[in] block_size	bytes read at once, a block is extended to the end of its last line
+	 * @param[in] consume	called with each block, a compressed file is decompressed on the way
+	 */
+	template<typename ConsumerType>
+	void forEachLineBlock(const bfs::path & path, const size_t block_size, ConsumerType consume) {
+		bios::filtering_istream input;
+		CompressedStreams::openInput(input, path);
+
+		string block;
+		string carried; ///< The unfinished line from the end of the previous block.
+		while (input) {
+			block.resize(block_size);
+			input.read(&block[0], block_size);
+			block.resize(static_cast<size_t>(input.gcount()));
+			block.insert(0, carried);
+			const size_t last_line_end = block.rfind('\n');
+			if (input && last_line_end != string::npos) {
+				carried.assign(block, last_line_end + 1, string::npos);
+				block.resize(last_line_end + 1);
+			}
+			else if (input) {
+				carried = move(block);
+				continue;
+			}
+			else {
+				carried.clear();
+			}
+			consume(string_view{ block });
+		}
+	}
+
+	// A directory of temporary files, removed with everything in it when destroyed
+	class TemporaryDirectory {
+		bfs::path path; ///< The directory.
+		size_t file_count = 0; ///< Number of the files named so far.
+
+	public:
+		TemporaryDirectory() : path(bfs::temp_directory_path() / bfs::unique_path("cnoadapters-%%%%-%%%%-%%%%")) {
+			bfs::create_directories(path);
+		}
+
+		~TemporaryDirectory() {
+			boost::system::error_code ignored;
+			bfs::remove_all(path, ignored);
+		}
+
+		NO_COPY_SHORT(TemporaryDirectory)
+
+		// @return	path of a new file in the directory
+		inline bfs::path newFile() {
+			return path / ("part" + to_string(file_count++));
+		}
+	};
+
+	// A buffered binary file stream of a run
+	template<typename StreamType>
+	class RunFile {
+		unique_ptr<char[]> buffer; ///< The stream buffer, it must outlive the stream.
+		StreamType stream; ///< The file.
+
+	public:
+		RunFile(const bfs::path & path, const ios::openmode mode) : buffer(new char[RUN_BUFFER_SIZE]) {
+			stream.rdbuf()->pubsetbuf(buffer.get(), RUN_BUFFER_SIZE);
+			stream.open(path.string(), mode | ios::binary);
+			if (!stream)
+				throw runtime_error("Could not open the temporary file \"" + path.string() + "\".\n");
+		}
+
+		inline StreamType & get() {
+			return stream;
+		}
+	};
+
+	/**
+	 * @brief Merges the sorted runs and passes the records to the consumer in the order.
+	 * @param[in] runs	the run files, at most MERGE_FAN_IN
+	 * @param[in] consume	called with each record, records that are equal come in the order of the runs
+	 */
+	template<typename Record, typename ConsumerType>
+	void mergeRuns(const vector<bfs::path> & runs, ConsumerType consume) {
+		vector<unique_ptr<RunFile<ifstream>>> files;
+		vector<Record> heads(runs.size());
+		for (const bfs::path & run : runs)
+			files.emplace_back(new RunFile<ifstream>(run, ios::in));
+
+		// The heap holds the run numbers, ordered by their current records, the earlier run goes first
+		auto later = [&heads](const size_t A, const size_t B) {
+			return heads[B] < heads[A] || (!(heads[A] < heads[B]) && A > B);
+		};
+		priority_queue<size_t, vector<size_t>, decltype(later)> heap(later);
+		for (const size_t run_no : cscope(runs))
+			if (heads[run_no].read(files[run_no]->get()))
+				heap.push(run_no);
+
+		while (!heap.empty()) {
+			const size_t run_no = heap.top();
+			heap.pop();
+			consume(heads[run_no]);
+			if (heads[run_no].read(files[run_no]->get()))
+				heap.push(run_no);
+		}
+	}
+
+	// Sorts the records added to it within the memory budget, spilling sorted runs to the temporary directory
+	template<typename Record>
+	class Sorter {
+		TemporaryDirectory & directory; ///< Where the runs go.
+		size_t budget; ///< Most bytes of the records held in memory.
+		vector<Record> records; ///< The records not yet spilled.
+		size_t used = 0; ///< Bytes of the records held.
+		vector<bfs::path> runs; ///< The runs spilled so far, in the order of the records.
+
+		// Writes the sorted records into a run file.
+		template<typename IteratorType>
+		void writeRun(IteratorType first, IteratorType last, const bfs::path & path) {
+			RunFile<ofstream> file(path, ios::out);
+			for (; first != last; ++first)
+				first->write(file.get());
+			if (!file.get().flush())
+				throw runtime_error("Could not write the temporary file \"" + path.string() + "\".\n");
+		}
+
+	public:
+		Sorter(TemporaryDirectory & _directory, const size_t _budget) : directory(_directory), budget(_budget) {}
+		NO_COPY_SHORT(Sorter)
+
+		inline void add(Record record) {
+			used += record.bytes();
+			records.push_back(move(record));
+			if (used >= budget)
+				spill();
+		}
+
+		// Writes the records held to a new run.
+		void spill() {
+			if (records.empty())
+				return;
+			stable_sort(begin(records), end(records));
+			runs.push_back(directory.newFile());
+			writeRun(begin(records), end(records), runs.back());
+			records = vector<Record>{};
+			used = 0;
+		}
+
+		// @return	number of the runs spilled so far
+		inline size_t runCount() const {
+			return runs.size();
+		}
+
+		// Passes all the records added to the consumer in the order, the sorter is then empty.
+		template<typename ConsumerType>
+		void merge(ConsumerType consume) {
+			// Everything fits in the memory, nothing is written
+			if (runs.empty()) {
+				stable_sort(begin(records), end(records));
+				for (const Record & record : records)
+					consume(record);
+				records = vector<Record>{};
+				used = 0;
+				return;
+			}
+			spill();
+
+			// Too many runs are merged in groups first, the order of the groups keeps the order of the equal records
+			while (runs.size() > MERGE_FAN_IN) {
+				vector<bfs::path> merged;
+				for (size_t first = 0; first < runs.size(); first += MERGE_FAN_IN) {
+					const vector<bfs::path> group(begin(runs) + first, begin(runs) + min(runs.size(), first + MERGE_FAN_IN));
+					merged.push_back(directory.newFile());
+					RunFile<ofstream> file(merged.back(), ios::out);
+					mergeRuns<Record>(group, [&file](const Record & record) { record.write(file.get()); });
+					if (!file.get().flush())
+						throw runtime_error("Could not write the temporary file \"" + merged.back().string() + "\".\n");
+					for (const bfs::path & run : group)
+						bfs::remove(run);
+				}
+				runs = move(merged);
+			}
+
+			mergeRuns<Record>(runs, consume);
+			for (const bfs::path & run : runs)
+				bfs::remove(run);
+			runs.clear();
+		}
+	};
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+#include "compressed_streams.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Read-only content of an input. Files are memory-mapped so that parsers can refer to the content in place instead of copying it,
+/// content that is already in the memory is either taken over or only viewed.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class InputBuffer {
+	bios::mapped_file_source mapped; ///< The mapping of the file, if the content is mapped.
+	vector<char> owned; ///< The content itself, if it is held in memory (the storage does not move with the buffer).
+	string_view borrowed; ///< The content, if it belongs to the caller.
+
+public:
+	NO_COPY(InputBuffer)
+
+	/**
+	 * @brief Maps the file into the memory.
+	 * @param[in] path	path to an existing file
+	 * @return	a buffer viewing the whole content of the file
+	 */
+	static InputBuffer map(const bfs::path & path) {
+		if (!bfs::exists(path))
+			throw invalid_argument("Wrong filename \"" + path.string() + "\".\n");
+
+		InputBuffer result;
+		// Empty files can not be mapped, an empty buffer is equivalent
+		if (bfs::file_size(path) > 0)
+			result.mapped.open(path.string());
+		return result;
+	}
+
+	/**
+	 * @brief The content of a mapped file, decompressed into the memory if the file has the extension of a compression.
+	 * @param[in] stored	the file as it is stored, the result of a plain file views it and must not outlive it
+	 * @param[in] path	path of the file
+	 * @return	a buffer with the content of the file after the decompression
+	 */
+	static InputBuffer decompressed(const InputBuffer & stored, const bfs::path & path) {
+		const CompressedStreams::Codec codec = CompressedStreams::codecOf(path);
+		if (codec == CompressedStreams::Codec::None)
+			return borrow(stored.view());
+		return own(CompressedStreams::decompress(stored.view(), codec, path.string()));
+	}
+
+	/**
+	 * @brief Takes over the content that is already in the memory.
+	 * @param[in] content	the data to hold
+	 * @return	a buffer owning the content
+	 */
+	static InputBuffer own(vector<char> content) {
+		InputBuffer result;
+		result.owned = move(content);
+		return result;
+	}
+
+	/**
+	 * @brief Views the content owned by the caller, nothing is copied.
+	 * @param[in] content	the data, they must outlive the buffer and everything parsed from it
+	 * @return	a buffer viewing the content
+	 */
+	static InputBuffer borrow(const string_view content) {
+		InputBuffer result;
+		result.borrowed = content;
+		return result;
+	}
+
+	/**
+	 * @brief Reads the rest of the stream into the memory.
+	 * @param[in,out] input	the stream to read
+	 * @return	a buffer owning the content
+	 */
+	static InputBuffer read(istream & input) {
+		vector<char> content{ istreambuf_iterator<char>(input), istreambuf_iterator<char>() };
+		if (input.bad())
+			throw runtime_error("Could not read the input stream.\n");
+		return own(move(content));
+	}
+
+	// @return	view of the complete content, valid as long as the buffer exists
+	string_view view() const {
+		if (mapped.is_open())
+			return string_view{ mapped.data(), mapped.size() };
+		if (!owned.empty())
+			return string_view{ owned.data(), owned.size() };
+		return borrowed;
+	}
+};
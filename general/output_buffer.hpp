@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+#include "compressed_streams.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Output formatted into a single growable buffer. Nothing is flushed while formatting, the whole content is written by a single write
+/// (outputs larger than the memory are appended to their file in parts instead). The storage of a destroyed buffer is kept for the next one,
+/// so that a resident process does not allocate its output buffers anew for every request.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class OutputBuffer {
+	static const size_t MIN_SPARE_CAPACITY = 1 << 12; ///< Smaller storages are not kept.
+	static const size_t MAX_SPARE_BYTES = 1 << 26; ///< The most memory held by the kept storages together.
+	inline static mutex spare_mutex; ///< Guards the kept storages.
+	inline static vector<string> spare; ///< Empty storages of the destroyed buffers.
+	inline static size_t spare_bytes = 0; ///< Capacity of the kept storages.
+
+	string content; ///< The formatted output.
+
+	// @return	an empty storage kept from a destroyed buffer, a new one if there is none
+	static string takeSpare() {
+		lock_guard<mutex> lock(spare_mutex);
+		if (spare.empty())
+			return string{};
+		string result = move(spare.back());
+		spare.pop_back();
+		spare_bytes -= result.capacity();
+		return result;
+	}
+
+public:
+	OutputBuffer() : content(takeSpare()) {}
+	DEFAULT_MOVE(OutputBuffer)
+	NO_COPY_SHORT(OutputBuffer)
+
+	// Creates the buffer with the memory for the expected size of the output preallocated.
+	explicit OutputBuffer(const size_t expected_size) : content(takeSpare()) {
+		content.reserve(expected_size);
+	}
+
+	// The storage is kept for the next buffer, unless it is small or too much memory is kept already.
+	~OutputBuffer() {
+		const size_t capacity = content.capacity();
+		if (capacity < MIN_SPARE_CAPACITY)
+			return;
+		lock_guard<mutex> lock(spare_mutex);
+		if (spare_bytes + capacity > MAX_SPARE_BYTES)
+			return;
+		try {
+			content.clear();
+			spare.push_back(move(content));
+			spare_bytes += capacity;
+		}
+		catch (bad_alloc &) {
+			// Not kept, it is freed
+		}
+	}
+
+	// Preallocates the memory for the expected size of the output.
+	inline void reserve(const size_t expected_size) {
+		content.reserve(expected_size);
+	}
+
+	inline OutputBuffer & operator<<(const string_view text) {
+		content.append(text);
+		return *this;
+	}
+
+	inline OutputBuffer & operator<<(const char character) {
+		content.push_back(character);
+		return *this;
+	}
+
+	inline OutputBuffer & operator<<(const size_t number) {
+		char digits[20];
+		const auto end = to_chars(digits, digits + sizeof(digits), number).ptr;
+		content.append(digits, end);
+		return *this;
+	}
+
+	// @return	the content formatted so far
+	inline const string & str() const {
+		return content;
+	}
+
+	// @return	the content, the buffer is left empty
+	inline string release() {
+		return move(content);
+	}
+
+	// Appends the content to the stream and empties the buffer, for outputs too large to be held whole.
+	void flushTo(ostream & output) {
+		output.write(content.data(), content.size());
+		content.clear();
+	}
+
+	// Writes the bytes to the file by a single write, replacing the file, the file is checked once it is closed.
+	static void writeBytes(const string & filename, const string_view bytes) {
+		ofstream output;
+		// Unbuffered, the content goes to the file directly
+		output.rdbuf()->pubsetbuf(nullptr, 0);
+		output.open(filename, ios::out | ios::binary);
+		output.write(bytes.data(), bytes.size());
+		output.close();
+		if (output.fail())
+			throw runtime_error("Could not write the file \"" + filename + "\".\n");
+	}
+
+	// Writes the content to the file by a single write, replacing the file. A file with the extension of a compression is compressed in memory first.
+	void writeToFile(const string & filename) const {
+		const CompressedStreams::Codec codec = CompressedStreams::codecOf(filename);
+		if (codec == CompressedStreams::Codec::None)
+			return writeBytes(filename, content);
+
+		string compressed;
+		{
+			bios::filtering_ostream compressor;
+			CompressedStreams::pushCompressor(compressor, codec);
+			compressor.push(bios::back_inserter(compressed));
+			compressor.write(content.data(), content.size());
+		}
+		writeBytes(filename, compressed);
+	}
+};
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+#include "common_functions.hpp"
+#include "thread_pool.hpp"
+
+#ifdef __unix__
+#include <sys/resource.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Per-stage profiling of a conversion. A stage records its time, the bytes and the number of the allocations done within it and the peak
+/// resident size of the process at its end. The records of a stage that runs many times (e.g. on the worker threads) are summed, except for
+/// the wall time, which runs while any call of the stage runs - the time of the single calls is summed separately as the thread time.
+/// A stage on a worker thread of a pool counts the allocations of its own thread, any other stage those of the whole process (i.e. also
+/// of the workers it starts). When the profiling is off, a stage does not even read the clock.
+/// The allocations are only counted if the program includes allocation_hooks.hpp.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace Profiler {
+	inline atomic<bool> enabled{ false }; ///< Set once at the start of the program, before any of the threads.
+	inline atomic<size_t> allocated_bytes{ 0 }; ///< Bytes allocated by all the threads while the profiling is on.
+	inline atomic<size_t> allocation_count{ 0 }; ///< Allocations done by all the threads while the profiling is on.
+	inline thread_local size_t thread_allocated_bytes = 0; ///< Bytes allocated by this thread while the profiling is on.
+	inline thread_local size_t thread_allocation_count = 0; ///< Allocations done by this thread while the profiling is on.
+
+	// Counts an allocation of the given size, called by the allocation hooks.
+	inline void countAllocation(const size_t size) {
+		allocated_bytes.fetch_add(size, memory_order_relaxed);
+		allocation_count.fetch_add(1, memory_order_relaxed);
+		thread_allocated_bytes += size;
+		thread_allocation_count++;
+	}
+
+	// Summed measurements of a single stage
+	struct StageRecord {
+		string name; ///< Name of the stage.
+		size_t calls; ///< How many times the stage ran.
+		double seconds; ///< Wall time while at least one call of the stage ran.
+		double thread_seconds; ///< Time of the calls summed, above the wall time if the calls ran in parallel.
+		size_t bytes; ///< Total bytes allocated.
+		size_t allocations; ///< Total number of allocations.
+		size_t peak_rss_kb; ///< The largest peak resident size seen at the end of the stage.
+		size_t running; ///< Calls that started and did not finish yet.
+		chrono::steady_clock::time_point running_since; ///< When the running calls started to overlap.
+	};
+
+	// @return	the peak resident set size of the process in kilobytes, 0 where it is not available
+	inline size_t peakRssKb() {
+#ifdef __unix__
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+			return static_cast<size_t>(usage.ru_maxrss);
+#endif
+		return 0;
+	}
+
+	// The records of all the stages, in the order in which the stages first started
+	class Report {
+		mutex access; ///< Guards the records, stages run on many threads.
+		vector<StageRecord> records; ///< One per stage name.
+
+		// @return	the record of the stage, a new one for a new name
+		StageRecord & recordOf(const string & name) {
+			auto record = find_if(begin(records), end(records), [&name](const StageRecord & record) { return record.name == name; });
+			if (record == end(records))
+				record = records.insert(end(records), StageRecord{ name, 0, 0., 0., 0, 0, 0, 0, {} });
+			return *record;
+		}
+
+	public:
+		// Notes the start of a call of the stage, the wall time of the stage runs from the first of the overlapping calls.
+		void start(const string & name, const chrono::steady_clock::time_point now) {
+			lock_guard<mutex> lock(access);
+			StageRecord & record = recordOf(name);
+			if (record.running++ == 0)
+				record.running_since = now;
+		}
+
+		// Adds a finished call of the stage to its record.
+		void add(const string & name, const chrono::steady_clock::time_point started, const size_t bytes, const size_t allocations) {
+			const size_t peak_rss_kb = peakRssKb();
+			const auto now = chrono::steady_clock::now();
+			lock_guard<mutex> lock(access);
+			StageRecord & record = recordOf(name);
+			record.calls++;
+			record.thread_seconds += chrono::duration<double>(now - started).count();
+			if (--record.running == 0)
+				record.seconds += chrono::duration<double>(now - record.running_since).count();
+			record.bytes += bytes;
+			record.allocations += allocations;
+			record.peak_rss_kb = max(record.peak_rss_kb, peak_rss_kb);
+		}
+
+		// @return	the report as a JSON document
+		string toJson(const string & tool) {
+			lock_guard<mutex> lock(access);
+			string result = "{\n\t\"tool\": \"" + tool + "\",\n\t\"peak_rss_kb\": " + to_string(peakRssKb()) + ",\n\t\"stages\": [";
+			for (const size_t record_no : cscope(records)) {
+				const StageRecord & record = records[record_no];
+				result += record_no == 0 ? "\n" : ",\n";
+				result += "\t\t{\"stage\": \"" + record.name + "\", \"calls\": " + to_string(record.calls) + ", \"seconds\": " + to_string(record.seconds)
+					+ ", \"thread_seconds\": " + to_string(record.thread_seconds)
+					+ ", \"allocated_bytes\": " + to_string(record.bytes) + ", \"allocations\": " + to_string(record.allocations)
+					+ ", \"peak_rss_kb\": " + to_string(record.peak_rss_kb) + "}";
+			}
+			result += "\n\t]\n}\n";
+			return result;
+		}
+	};
+
+	inline Report report; ///< The report of this process.
+
+	// Measures the code from its construction to stop() or to its destruction, whichever comes first.
+	class Stage {
+		const char * name; ///< Name of the stage in the report.
+		bool running; ///< False if the profiling is off or the stage already stopped.
+		chrono::steady_clock::time_point start; ///< When the stage started.
+		bool per_thread = false; ///< The allocations are counted for the thread only, on a worker of a pool.
+		size_t start_bytes = 0; ///< Bytes allocated before the stage.
+		size_t start_count = 0; ///< Allocations done before the stage.
+
+		// @return	the bytes and the number of the allocations so far, of the thread or of the process
+		inline pair<size_t, size_t> allocations() const {
+			if (per_thread)
+				return { thread_allocated_bytes, thread_allocation_count };
+			return { allocated_bytes.load(memory_order_relaxed), allocation_count.load(memory_order_relaxed) };
+		}
+
+	public:
+		NO_COPY_SHORT(Stage)
+
+		explicit Stage(const char * name) : name(name), running(enabled.load(memory_order_relaxed)) {
+			if (!running)
+				return;
+			per_thread = on_pool_worker;
+			tie(start_bytes, start_count) = allocations();
+			start = chrono::steady_clock::now();
+			report.start(name, start);
+		}
+
+		// Ends the stage and adds it to the report.
+		inline void stop() {
+			if (!running)
+				return;
+			running = false;
+			const auto counted = allocations();
+			report.add(name, start, counted.first - start_bytes, counted.second - start_count);
+		}
+
+		~Stage() {
+			stop();
+		}
+	};
+}
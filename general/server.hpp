@@ -0,0 +1,202 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+#include "batch.hpp"
+
+#include <boost/iostreams/device/file_descriptor.hpp>
+#include <boost/iostreams/stream.hpp>
+#ifdef __unix__
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file A resident conversion server. The process stays up and converts the inputs it is sent, the state kept between the requests
+/// (e.g. the compiled header schemas) makes small conversions cheap. The requests come from the standard input or from the clients of
+/// a Unix domain socket, one client after another. The protocol is line based, each request line gets exactly one response line:
+///		<input>		an input as on the command line (a file, a directory, a glob pattern or @manifest), it is converted with the options of the server
+///					-> "OK <milliseconds> <input>" or "FAILED <milliseconds> <input>: <message>"
+///		!stats		-> "STATS requests <count> failed <count> mean_ms <milliseconds> max_ms <milliseconds>"
+///		!shutdown	-> "BYE", the server stops
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace Server {
+	const string STDIN_SOURCE("-"); ///< The value of --serve that reads the requests from the standard input.
+	const string STATS_COMMAND("!stats"); ///< Request for the statistics of the server.
+	const string SHUTDOWN_COMMAND("!shutdown"); ///< Request to stop the server.
+	const chrono::milliseconds ACCEPT_BACKOFF(100); ///< Wait before accepting again when the process is out of descriptors or memory.
+
+	// Latencies of the requests served so far
+	struct Statistics {
+		size_t requests = 0; ///< Conversion requests served.
+		size_t failed = 0; ///< Requests with at least one failed file.
+		double total_ms = 0.; ///< Sum of the latencies.
+		double max_ms = 0.; ///< The largest latency.
+	};
+
+	// @return	the milliseconds as a text with three decimals
+	inline string formatMs(const double milliseconds) {
+		char digits[32];
+		snprintf(digits, sizeof(digits), "%.3f", milliseconds);
+		return digits;
+	}
+
+	/**
+	 * @brief Converts all the inputs of the request, one file after another.
+	 * @param[in] request	the input argument
+	 * @param[in] extension	extension of the inputs of the tool, for directories
+	 * @param[in] convert	conversion of a single file, failures are reported by exceptions
+	 * @param[in,out] statistics	the statistics, the request is added
+	 * @return	the response line
+	 */
+	template<typename ConvertType>
+	string handleRequest(const string & request, const string & extension, ConvertType & convert, Statistics & statistics) {
+		const auto start = chrono::steady_clock::now();
+		string failure;
+		size_t failed_files = 0, file_count = 1;
+		try {
+			if (Batch::isBatch(request)) {
+				const vector<bfs::path> inputs = Batch::expandInputs(request, extension);
+				file_count = inputs.size();
+				for (const bfs::path & input : inputs) {
+					try {
+						convert(input);
+					}
+					catch (exception & e) {
+						if (failure.empty())
+							failure = input.string() + ": " + alg::trim_copy(string{ e.what() });
+						failed_files++;
+					}
+				}
+			}
+			else {
+				convert(bfs::path{ request });
+			}
+		}
+		catch (exception & e) {
+			failure = alg::trim_copy(string{ e.what() });
+			failed_files = file_count;
+		}
+		const double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+		statistics.requests++;
+		statistics.total_ms += milliseconds;
+		statistics.max_ms = max(statistics.max_ms, milliseconds);
+		if (failed_files == 0)
+			return "OK " + formatMs(milliseconds) + " " + request;
+
+		statistics.failed++;
+		if (file_count > 1)
+			failure += " (" + to_string(failed_files) + " of " + to_string(file_count) + " files failed)";
+		return "FAILED " + formatMs(milliseconds) + " " + request + ": " + failure;
+	}
+
+	/**
+	 * @brief Answers the requests from the stream until it ends or the server is shut down.
+	 * @return	false iff the server was shut down
+	 */
+	template<typename ConvertType>
+	bool serveStream(istream & requests, ostream & responses, const string & extension, ConvertType & convert, Statistics & statistics) {
+		string line;
+		while (getline(requests, line)) {
+			alg::trim(line);
+			if (line.empty())
+				continue;
+
+			if (line == SHUTDOWN_COMMAND) {
+				responses << "BYE" << endl;
+				return false;
+			}
+			if (line == STATS_COMMAND) {
+				const double mean_ms = statistics.requests == 0 ? 0. : statistics.total_ms / statistics.requests;
+				responses << "STATS requests " << statistics.requests << " failed " << statistics.failed
+					<< " mean_ms " << formatMs(mean_ms) << " max_ms " << formatMs(statistics.max_ms) << endl;
+				continue;
+			}
+			responses << handleRequest(line, extension, convert, statistics) << endl;
+			if (!responses)
+				break;
+		}
+		return true;
+	}
+
+	// Answers the clients of the socket, one after another, until one of them shuts the server down.
+	template<typename ConvertType>
+	void serveSocket(const string & socket_path, const string & extension, ConvertType & convert, Statistics & statistics) {
+#ifdef __unix__
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		if (socket_path.size() >= sizeof(address.sun_path))
+			throw invalid_argument("The socket path \"" + socket_path + "\" is too long.\n");
+		copy(begin(socket_path), end(socket_path), address.sun_path);
+
+		// A socket left behind by a server that did not stop cleanly is replaced
+		if (bfs::exists(socket_path) && bfs::status(socket_path).type() == bfs::socket_file)
+			bfs::remove(socket_path);
+
+		const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (server < 0 || ::bind(server, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(server, 16) != 0) {
+			if (server >= 0)
+				close(server);
+			throw runtime_error("Could not listen on the socket \"" + socket_path + "\".\n");
+		}
+		// A client that leaves early must not kill the server
+		signal(SIGPIPE, SIG_IGN);
+
+		bool running = true;
+		while (running) {
+			const int client = accept(server, nullptr, nullptr);
+			if (client < 0) {
+				// An interrupted call or a client that left before it was accepted is retried, a lack of resources may pass
+				const int error = errno;
+				if (error == EINTR || error == ECONNABORTED)
+					continue;
+				if (error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM) {
+					cerr << "Could not accept a client: " << strerror(error) << ", retrying.\n";
+					this_thread::sleep_for(ACCEPT_BACKOFF);
+					continue;
+				}
+				close(server);
+				bfs::remove(socket_path);
+				throw runtime_error("Could not accept a client on the socket \"" + socket_path + "\": " + strerror(error) + ".\n");
+			}
+			bios::stream<bios::file_descriptor_source> requests(bios::file_descriptor_source(client, bios::never_close_handle));
+			bios::stream<bios::file_descriptor_sink> responses(bios::file_descriptor_sink(client, bios::never_close_handle));
+			try {
+				running = serveStream(requests, responses, extension, convert, statistics);
+			}
+			catch (exception &) {
+				// The connection failed, the next client is served
+			}
+			close(client);
+		}
+
+		close(server);
+		bfs::remove(socket_path);
+#else
+		throw invalid_argument("Unix domain sockets are not available on this system, use --serve " + STDIN_SOURCE + ".\n");
+#endif
+	}
+
+	/**
+	 * @brief Runs the server until the requests end or it is shut down.
+	 * @param[in] source	path of the socket to listen on, or STDIN_SOURCE to read the standard input
+	 * @param[in] extension	extension of the inputs of the tool, for directories
+	 * @param[in] convert	conversion of a single file, failures are reported by exceptions
+	 */
+	template<typename ConvertType>
+	void serve(const string & source, const string & extension, ConvertType convert) {
+		Statistics statistics;
+		if (source == STDIN_SOURCE)
+			serveStream(cin, cout, extension, convert, statistics);
+		else
+			serveSocket(source, extension, convert, statistics);
+	}
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+#include "common_functions.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file A pool of worker threads with work stealing. Each worker has its own queue, it takes tasks from the back of it and when it runs dry,
+/// it steals from the front of the queues of the others. The first exception thrown by a task is passed on to the thread that waits for the pool.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline thread_local bool on_pool_worker = false; ///< True on the worker threads of a pool.
+
+class WorkStealingPool {
+	struct TaskQueue {
+		mutex access; ///< Guards the tasks.
+		deque<function<void()>> tasks; ///< Tasks not yet started.
+	};
+
+	vector<unique_ptr<TaskQueue>> queues; ///< One queue for each worker.
+	vector<thread> workers; ///< The worker threads.
+	mutex state_access; ///< Guards the counters below.
+	condition_variable work_available; ///< Signalled when a task is submitted or the pool stops.
+	condition_variable work_done; ///< Signalled when the last unfinished task finishes.
+	size_t queued = 0; ///< Tasks in the queues.
+	size_t unfinished = 0; ///< Tasks submitted and not yet finished.
+	bool stopping = false; ///< Set when the pool is being destroyed.
+	size_t next_queue = 0; ///< Queue that receives the next submitted task.
+	exception_ptr failure; ///< The first exception thrown by a task.
+
+	// @return	true iff a task was taken from the back of the worker's own queue
+	bool popOwn(const size_t worker_no, function<void()> & task) {
+		TaskQueue & queue = *queues[worker_no];
+		lock_guard<mutex> lock(queue.access);
+		if (queue.tasks.empty())
+			return false;
+		task = move(queue.tasks.back());
+		queue.tasks.pop_back();
+		return true;
+	}
+
+	// @return	true iff a task was taken from the front of the queue of some other worker
+	bool steal(const size_t worker_no, function<void()> & task) {
+		for (const size_t offset : crange<size_t>(1, queues.size())) {
+			TaskQueue & queue = *queues[(worker_no + offset) % queues.size()];
+			lock_guard<mutex> lock(queue.access);
+			if (queue.tasks.empty())
+				continue;
+			task = move(queue.tasks.front());
+			queue.tasks.pop_front();
+			return true;
+		}
+		return false;
+	}
+
+	void work(const size_t worker_no) {
+		on_pool_worker = true;
+		while (true) {
+			function<void()> task;
+			if (popOwn(worker_no, task) || steal(worker_no, task)) {
+				{
+					lock_guard<mutex> lock(state_access);
+					queued--;
+				}
+				try {
+					task();
+				}
+				catch (...) {
+					lock_guard<mutex> lock(state_access);
+					if (!failure)
+						failure = current_exception();
+				}
+				lock_guard<mutex> lock(state_access);
+				if (--unfinished == 0)
+					work_done.notify_all();
+				continue;
+			}
+
+			unique_lock<mutex> lock(state_access);
+			work_available.wait(lock, [this] { return stopping || queued > 0; });
+			if (stopping && queued == 0)
+				return;
+		}
+	}
+
+public:
+	NO_COPY_SHORT(WorkStealingPool)
+
+	explicit WorkStealingPool(const size_t thread_count) {
+		for (size_t worker_no = 0; worker_no < max<size_t>(1, thread_count); worker_no++)
+			queues.emplace_back(new TaskQueue);
+		for (const size_t worker_no : cscope(queues))
+			workers.emplace_back(&WorkStealingPool::work, this, worker_no);
+	}
+
+	~WorkStealingPool() {
+		{
+			lock_guard<mutex> lock(state_access);
+			stopping = true;
+		}
+		work_available.notify_all();
+		for (thread & worker : workers)
+			worker.join();
+	}
+
+	// Enqueues the task, the queues receive the tasks in turns.
+	void submit(function<void()> task) {
+		size_t queue_no;
+		{
+			lock_guard<mutex> lock(state_access);
+			queued++;
+			unfinished++;
+			queue_no = next_queue;
+			next_queue = (next_queue + 1) % queues.size();
+		}
+		{
+			lock_guard<mutex> lock(queues[queue_no]->access);
+			queues[queue_no]->tasks.emplace_back(move(task));
+		}
+		work_available.notify_one();
+	}
+
+	// Blocks until all the submitted tasks are finished, then rethrows the first exception of a task, if there was any.
+	void wait() {
+		unique_lock<mutex> lock(state_access);
+		work_done.wait(lock, [this] { return unfinished == 0; });
+		if (failure) {
+			exception_ptr to_throw = failure;
+			failure = nullptr;
+			rethrow_exception(to_throw);
+		}
+	}
+};
+
+/**
+ * @brief Calls the function for each of the items, in parallel if more than one thread is requested.
+ * @param[in] thread_count	number of worker threads, with 1 or less the items are processed in order in the calling thread
+ * @param[in] items	the values the function is called with
+ * @param[in] work	the work for a single item
+ */
+template<typename ItemType, typename WorkType>
+void forEachParallel(const size_t thread_count, const vector<ItemType> & items, WorkType work) {
+	if (thread_count <= 1) {
+		for (const ItemType & item : items)
+			work(item);
+		return;
+	}
+
+	WorkStealingPool pool(min(thread_count, items.size()));
+	for (const ItemType & item : items)
+		pool.submit([&work, &item] { work(item); });
+	pool.wait();
+}
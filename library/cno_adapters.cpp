@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#include "cno_adapters.hpp"
+
+namespace CNOAdapters {
+	// @return	the schemas shared by all the conversions of the process, hosts convert many files with the same header
+	SchemaCache & sharedSchemas() {
+		static SchemaCache schemas;
+		return schemas;
+	}
+
+	vector<Experiment> readExperiments(InputBuffer input, const ConversionSettings & settings) {
+		ExperimentSet set = prepareExperiments(move(input), settings, sharedSchemas());
+		forEachParallel(settings.thread_count, set.converted, [&set](const size_t expr_no) {
+			computeSeries(set, expr_no);
+		});
+
+		vector<Experiment> result;
+		result.reserve(set.converted.size());
+		for (const size_t expr_no : set.converted)
+			result.emplace_back(move(set.experiments[expr_no]));
+		return result;
+	}
+
+	vector<Experiment> readExperiments(istream & input, const ConversionSettings & settings) {
+		return readExperiments(InputBuffer::read(input), settings);
+	}
+
+	string serializeExperiment(const Experiment & experiment) {
+		OutputBuffer output(estimatePropertySize(experiment));
+		writeProperty(experiment, output);
+		return output.release();
+	}
+
+	map<string, string> convertMidas(InputBuffer input, const ConversionSettings & settings) {
+		map<string, string> result;
+		for (const Experiment & experiment : readExperiments(move(input), settings))
+			result[getExprName(experiment)] = serializeExperiment(experiment);
+		return result;
+	}
+
+	map<string, string> convertMidas(istream & input, const ConversionSettings & settings) {
+		return convertMidas(InputBuffer::read(input), settings);
+	}
+
+	string serializeContainer(const vector<Experiment> & experiments) {
+		vector<pair<string, string>> properties;
+		for (const Experiment & experiment : experiments)
+			properties.emplace_back(getExprName(experiment), serializeExperiment(experiment));
+		OutputBuffer output;
+		formatContainer(properties, output);
+		return output.release();
+	}
+
+	SifGraph readGraph(InputBuffer input, const size_t thread_count) {
+		return ::readGraph(input.view(), thread_count);
+	}
+
+	SifGraph readGraph(istream & input, const size_t thread_count) {
+		return readGraph(InputBuffer::read(input), thread_count);
+	}
+
+	string serializeModel(const SifGraph & graph) {
+		OutputBuffer output;
+		formatModel(graph, POSITIVE_LABEL, NEGATIVE_LABEL, output);
+		return output.release();
+	}
+
+	string convertSif(InputBuffer input, const size_t thread_count) {
+		return serializeModel(readGraph(move(input), thread_count));
+	}
+
+	string convertSif(istream & input, const size_t thread_count) {
+		return convertSif(InputBuffer::read(input), thread_count);
+	}
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#pragma once
+
+#include "../MidasToPpf/midas_conversion.hpp"
+#include "../SifToPmf/sif_conversion.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file The conversions as a library (libcnoadapters.a) for programs that convert many inputs in a single process. Nothing is read from
+/// or written to files: the inputs are buffers (see InputBuffer::own and InputBuffer::borrow) or streams, the results are the converted
+/// objects or the text the tools would write into the files. All the functions may be called from more threads at once.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+namespace CNOAdapters {
+	/**
+	 * @brief Converts the MIDAS content into experiments.
+	 * @param[in] input	the content of a MIDAS file
+	 * @param[in] settings	the options of the conversion, the cache directory is ignored
+	 * @return	the experiments with their time series, ordered by the setup; of the experiments with the same name only the last one is kept
+	 */
+	vector<Experiment> readExperiments(InputBuffer input, const ConversionSettings & settings);
+	vector<Experiment> readExperiments(istream & input, const ConversionSettings & settings);
+
+	// @return	the property text of the experiment, the content of its .ppf file
+	string serializeExperiment(const Experiment & experiment);
+
+	// @return	for each experiment of the MIDAS content its name (the suffix of its .ppf file) and its property text
+	map<string, string> convertMidas(InputBuffer input, const ConversionSettings & settings);
+	map<string, string> convertMidas(istream & input, const ConversionSettings & settings);
+
+	// @return	the experiments in a property container (see PropertyContainer for reading it), the content of the .ppfc file
+	string serializeContainer(const vector<Experiment> & experiments);
+
+	/**
+	 * @brief Converts the SIF content into a regulatory graph.
+	 * @param[in] input	the content of a SIF file
+	 * @param[in] thread_count	number of threads parsing the content
+	 * @return	the graph, it does not refer to the input
+	 */
+	SifGraph readGraph(InputBuffer input, const size_t thread_count = 1);
+	SifGraph readGraph(istream & input, const size_t thread_count = 1);
+
+	// @return	the model text of the graph, the content of its .pmf file
+	string serializeModel(const SifGraph & graph);
+
+	// @return	the model text of the SIF content
+	string convertSif(InputBuffer input, const size_t thread_count = 1);
+	string convertSif(istream & input, const size_t thread_count = 1);
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#include "../MidasToPpf/midas_conversion.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file The conversion cache when an experiment disappears from the input: its output must be dropped from the cache entry,
+/// so that once the orphaned output is deleted, the unchanged input is skipped again.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const string HEADER = "TR:Cell:CellLine,TR:S0,TR:S1,DA:ALL,DV:P0,DV:P1\n"; ///< Two stimuli, the experiments are m, m_S0 and m_S1.
+const string BASE_ROWS = "1,0,0,0,0.1,0.9\n1,0,0,10,0.9,0.1\n1,0,1,0,0.1,0.1\n1,0,1,10,0.9,0.9\n"; ///< Rows of m and m_S1.
+const string S0_ROWS = "1,1,0,0,0.9,0.9\n1,1,0,10,0.1,0.1\n"; ///< Rows of m_S0.
+
+// Writes the text to the file.
+void writeText(const bfs::path & path, const string & text) {
+	OutputBuffer output;
+	output << text;
+	output.writeToFile(path.string());
+}
+
+// @return	the lines of the single cache entry in the directory
+vector<string> readEntry(const bfs::path & cache_dir) {
+	vector<string> result;
+	for (const bfs::directory_entry & entry : bfs::directory_iterator(cache_dir)) {
+		ifstream file(entry.path().string());
+		string line;
+		while (getline(file, line))
+			result.push_back(line);
+	}
+	return result;
+}
+
+int main() {
+	size_t failures = 0;
+	auto check = [&failures](const bool condition, const string & message) {
+		if (!condition) {
+			cerr << "Failed: " << message << "\n";
+			failures++;
+		}
+	};
+
+	ExternalSort::TemporaryDirectory directory;
+	const bfs::path work = directory.newFile();
+	bfs::create_directories(work);
+	const bfs::path input = work / "m.csv", cache_dir = work / "cache", orphan = work / "m_S0.ppf";
+	ConversionSettings settings{ 0.1, 1, cache_dir.string() };
+	SchemaCache schemas;
+
+	writeText(input, HEADER + BASE_ROWS + S0_ROWS);
+	convertFile(input, settings, schemas);
+	check(bfs::exists(orphan), "m_S0.ppf is written by the first conversion");
+
+	// Without the rows of m_S0, its output is no longer recorded
+	writeText(input, HEADER + BASE_ROWS);
+	convertFile(input, settings, schemas);
+	const vector<string> entry = readEntry(cache_dir);
+	check(none_of(begin(entry), end(entry), [](const string & line) { return line.find("m_S0.ppf") != string::npos; }),
+		"the output of the disappeared experiment is dropped from the cache entry");
+	check(any_of(begin(entry), end(entry), [](const string & line) { return line.find("m_S1.ppf") != string::npos; }),
+		"the output of a remaining experiment stays in the cache entry");
+
+	// Once the orphan is deleted, the unchanged input is still up to date
+	bfs::remove(orphan);
+	const auto key_line = find_if(begin(entry), end(entry), [](const string & line) { return line.compare(0, 4, "key ") == 0; });
+	check(key_line != end(entry), "the cache entry holds the key of the input");
+	if (key_line != end(entry))
+		check(CacheEntry::load(cache_dir, input).upToDate(key_line->substr(4)), "the unchanged input is skipped after the orphan is deleted");
+
+	cout << (failures == 0 ? "The conversion cache drops the outputs of disappeared experiments.\n" : "The conversion cache failed.\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#include "../MidasToPpf/midas_conversion.hpp"
+#include "../bench/generators.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Equivalence of the conversion of a MIDAS file split into partitions (--memory-limit) with the conversion in memory, for the outputs
+/// file by file, the container and the discretization into levels. The outputs must be the same byte for byte.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const Generators::MidasParameters MIDAS_SHAPE{ 3000, 3, 1, 5, 4, 0.05, 0, 1 }; ///< A file with 16 setups of 5 readouts at 4 times.
+const size_t LIMIT_DIVISOR = 4; ///< The memory limit is this many times smaller than the conversion in memory needs.
+const size_t LEVEL_COUNT = 3; ///< Levels of the discretization.
+
+// @return	the content of each file in the directory but the input, by its name
+map<string, string> readOutputs(const bfs::path & dir, const bfs::path & input) {
+	map<string, string> result;
+	for (const bfs::directory_entry & entry : bfs::directory_iterator(dir)) {
+		if (entry.path().filename() == input.filename())
+			continue;
+		ifstream file(entry.path().string(), ios::in | ios::binary);
+		result[entry.path().filename().string()] = string{ istreambuf_iterator<char>(file), istreambuf_iterator<char>() };
+	}
+	return result;
+}
+
+// @return	the outputs of the conversion of the content, done in a directory of its own
+map<string, string> convertIn(const bfs::path & dir, const string & content, const ConversionSettings & settings) {
+	bfs::create_directories(dir);
+	const bfs::path input = dir / "generated.csv";
+	OutputBuffer output;
+	output << content;
+	output.writeToFile(input.string());
+	SchemaCache schemas;
+	convertFile(input, settings, schemas);
+	return readOutputs(dir, input);
+}
+
+int main() {
+	size_t failures = 0;
+	auto check = [&failures](const bool condition, const string & message) {
+		if (!condition) {
+			cerr << "Failed: " << message << "\n";
+			failures++;
+		}
+	};
+
+	ExternalSort::TemporaryDirectory directory;
+	const bfs::path work = directory.newFile();
+	const string content = Generators::generateMidas(MIDAS_SHAPE);
+	const size_t memory_limit = content.size() * MidasPartitions::MEMORY_PER_INPUT_BYTE / LIMIT_DIVISOR;
+
+	// The outputs file by file, the container and the levels
+	const vector<pair<string, ConversionSettings>> variants = {
+		{ "per-file", ConversionSettings{ 0.1, 1, "", false, 0, false, false, CompressedStreams::Codec::None, 0 } },
+		{ "container", ConversionSettings{ 0.1, 1, "", true, 0, false, false, CompressedStreams::Codec::None, 0 } },
+		{ "levels", ConversionSettings{ 0.1, 1, "", false, LEVEL_COUNT, false, false, CompressedStreams::Codec::None, 0 } },
+	};
+	for (const auto & variant : variants) {
+		ConversionSettings partitioned = variant.second;
+		partitioned.memory_limit = memory_limit;
+		check(needsPartitions(content.size(), partitioned), variant.first + ": the memory limit splits the file into partitions");
+
+		const map<string, string> in_memory = convertIn(work / (variant.first + "_memory"), content, variant.second);
+		const map<string, string> split = convertIn(work / (variant.first + "_partitions"), content, partitioned);
+		check(!in_memory.empty(), variant.first + ": the conversion in memory writes outputs");
+		check(in_memory.size() == split.size(), variant.first + ": " + to_string(in_memory.size()) + " outputs in memory, " + to_string(split.size()) + " from the partitions");
+		for (const auto & output : in_memory) {
+			const auto counterpart = split.find(output.first);
+			check(counterpart != end(split) && counterpart->second == output.second, variant.first + ": " + output.first + " is the same from the partitions");
+		}
+	}
+
+	cout << (failures == 0 ? "The conversion in partitions writes the same outputs as in memory.\n" : "The conversion in partitions differs from the conversion in memory.\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#include "../MidasToPpf/repetition_removal.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Comparison of the repetition removal with the original implementation on random series. The original removed the earliest
+/// repeated loop by comparing all the pairs of blocks and rescanned the series after every removal.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const size_t SERIES_COUNT = 20000; ///< Number of the random series.
+const size_t MAX_LENGTH = 30; ///< The longest random series.
+const uint32_t MAX_STATES = 6; ///< The most distinct states in a random series.
+const size_t SHAPE_LENGTH = 4000; ///< Length of the series A x1 A x2 ... that has no repeated loop.
+
+// The original removal of a single loop. @return	the series without its earliest repeated loop
+const vector<uint32_t> removeCycle(vector<uint32_t> original) {
+	vector<uint32_t> result;
+	for (auto it1 = begin(original); it1 != end(original); it1++) {
+		for (auto it2 = it1 + 1; it2 != end(original); it2++) {
+			if (*it1 != *it2)
+				continue;
+			for (auto it3 = it2; it3 != end(original); it3++) {
+				for (auto it4 = it3 + 1; it4 != end(original); it4++) {
+					if (*it3 != *it4 || (distance(it1, it2) != distance(it3, it4)))
+						continue;
+					if (equal(it1, it2, it3)) {
+						result = { begin(original), it3 };
+						copy(it4, end(original), back_inserter(result));
+						return result;
+					}
+				}
+			}
+		}
+	}
+	return original;
+}
+
+// @return	the series without any repeated loop, by the original implementation
+vector<uint32_t> removeRepetitive(const vector<uint32_t> & series) {
+	vector<uint32_t> original, result = series;
+	do {
+		original = result;
+		result = removeCycle(original);
+	} while (result != original);
+	return result;
+}
+
+// @return	the series without any repeated loop, by the current implementation
+vector<uint32_t> removeLoops(const vector<uint32_t> & series) {
+	vector<uint32_t> result;
+	for (const size_t position : RepetitionRemoval::findLoopFree(series))
+		result.push_back(series[position]);
+	return result;
+}
+
+int main() {
+	mt19937 generator(0);
+	size_t mismatches = 0;
+	for (const size_t series_no : crange(SERIES_COUNT)) {
+		const size_t length = uniform_int_distribution<size_t>(0, MAX_LENGTH)(generator);
+		uniform_int_distribution<uint32_t> state(0, uniform_int_distribution<uint32_t>(0, MAX_STATES - 1)(generator));
+		vector<uint32_t> series(length);
+		for (uint32_t & value : series)
+			value = state(generator);
+
+		if (removeLoops(series) != removeRepetitive(series)) {
+			mismatches++;
+			cerr << "Mismatch on the series " << series_no << ":";
+			for (const uint32_t value : series)
+				cerr << " " << value;
+			cerr << "\n";
+		}
+	}
+	cout << "Compared " << SERIES_COUNT << " random series, " << mismatches << " mismatches.\n";
+
+	vector<uint32_t> shape;
+	for (const size_t position : crange(SHAPE_LENGTH))
+		shape.push_back(position % 2 == 0 ? 0 : static_cast<uint32_t>(position / 2 + 1));
+	const auto start = chrono::steady_clock::now();
+	const size_t remaining = RepetitionRemoval::findLoopFree(shape).size();
+	const chrono::duration<double> seconds = chrono::steady_clock::now() - start;
+	cout << "The series A x1 A x2 ... of " << SHAPE_LENGTH << " states took " << seconds.count() << " s.\n";
+	if (remaining != SHAPE_LENGTH) {
+		cerr << "The series A x1 A x2 ... lost " << SHAPE_LENGTH - remaining << " states.\n";
+		mismatches++;
+	}
+
+	return mismatches == 0 ? 0 : 1;
+}
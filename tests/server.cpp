@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#include "../MidasToPpf/midas_conversion.hpp"
+#include "../general/server.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file The protocol of the resident server, spoken by a local client over the Unix domain socket: a conversion that succeeds,
+/// one that fails, a client that leaves early, the statistics and the shutdown.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const string MIDAS_CONTENT = "TR:Cell:CellLine,TR:S0,DA:ALL,DV:P0,DV:P1\n1,0,0,0.1,0.9\n1,0,10,0.9,0.1\n1,1,0,0.1,0.1\n1,1,10,0.9,0.9\n"; ///< A small valid input.
+const size_t CONNECT_ATTEMPTS = 100; ///< Attempts to connect while the server starts.
+const chrono::milliseconds CONNECT_WAIT(50); ///< Wait between the attempts.
+
+// A client of the socket, one line is sent and one is received at a time.
+class Client {
+	int socket_fd; ///< The connection.
+
+public:
+	NO_COPY(Client)
+
+	// Connects to the socket, the server may still be starting.
+	explicit Client(const string & socket_path) {
+		sockaddr_un address{};
+		address.sun_family = AF_UNIX;
+		copy(begin(socket_path), end(socket_path), address.sun_path);
+		for (size_t attempt = 0; attempt < CONNECT_ATTEMPTS; attempt++) {
+			socket_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+			if (connect(socket_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0)
+				return;
+			close(socket_fd);
+			this_thread::sleep_for(CONNECT_WAIT);
+		}
+		throw runtime_error("Could not connect to the socket \"" + socket_path + "\".\n");
+	}
+
+	~Client() {
+		close(socket_fd);
+	}
+
+	// Sends the line with its end.
+	void send(const string & line) {
+		const string message = line + "\n";
+		if (write(socket_fd, message.data(), message.size()) != static_cast<ssize_t>(message.size()))
+			throw runtime_error("Could not send the request \"" + line + "\".\n");
+	}
+
+	// @return	the next line received without its end, empty if the connection is closed
+	string receive() {
+		string line;
+		char character;
+		while (read(socket_fd, &character, 1) == 1 && character != '\n')
+			line.push_back(character);
+		return line;
+	}
+};
+
+int main() {
+	size_t failures = 0;
+	auto check = [&failures](const bool condition, const string & message) {
+		if (!condition) {
+			cerr << "Failed: " << message << "\n";
+			failures++;
+		}
+	};
+	// @return	true iff the text starts with the prefix
+	auto startsWith = [](const string & text, const string & prefix) {
+		return text.compare(0, prefix.size(), prefix) == 0;
+	};
+
+	ExternalSort::TemporaryDirectory directory;
+	const bfs::path work = directory.newFile();
+	bfs::create_directories(work);
+	const bfs::path input = work / "m.csv", missing = work / "missing.csv";
+	const string socket_path = (work / "server.sock").string();
+	OutputBuffer content;
+	content << MIDAS_CONTENT;
+	content.writeToFile(input.string());
+
+	ConversionSettings settings{ 0.1, 1, "" };
+	SchemaCache schemas;
+	thread server([&]() {
+		Server::serve(socket_path, MIDAS_EXTENSION, [&](const bfs::path & input_path) {
+			convertFile(input_path, settings, schemas);
+		});
+	});
+
+	try {
+		// A client that leaves without reading its response does not stop the server
+		{
+			Client early(socket_path);
+			early.send(input.string());
+		}
+
+		Client client(socket_path);
+		client.send(input.string());
+		const string converted = client.receive();
+		check(startsWith(converted, "OK ") && converted.find(input.string()) != string::npos, "a valid input is answered by OK, got \"" + converted + "\"");
+		check(bfs::exists(work / "m.ppf"), "the input is converted");
+
+		client.send(missing.string());
+		const string failed = client.receive();
+		check(startsWith(failed, "FAILED ") && failed.find(missing.string()) != string::npos, "a missing input is answered by FAILED, got \"" + failed + "\"");
+
+		client.send(Server::STATS_COMMAND);
+		const string stats = client.receive();
+		check(startsWith(stats, "STATS requests 3 failed 1 mean_ms "), "the statistics count all the requests, got \"" + stats + "\"");
+
+		client.send(Server::SHUTDOWN_COMMAND);
+		const string bye = client.receive();
+		check(bye == "BYE", "the shutdown is answered by BYE, got \"" + bye + "\"");
+	}
+	catch (exception & e) {
+		check(false, alg::trim_copy(string{ e.what() }));
+		// The server is stopped by a client of its own, so that it can be joined
+		Client(socket_path).send(Server::SHUTDOWN_COMMAND);
+	}
+	server.join();
+	check(!bfs::exists(socket_path), "the socket is removed on the shutdown");
+
+	cout << (failures == 0 ? "The server answers the requests, the statistics and the shutdown over the socket.\n" : "The server failed.\n");
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2014 - Adam Streck
+ * This file is a part of the CNOAdapters suite - tools for conversion of CellNetOptR-format files into Parsybone files
+ * This is a free software: you can redistribute it and/or modify it under the terms of the GNU General Public License version 3.
+ * The software is released without any warranty. See the GNU General Public License for more details. <http://www.gnu.org/licenses/>.
+ * For affiliations see <http://www.mi.fu-berlin.de/en/math/groups/dibimath>.
+ */
+#include "../SifToPmf/sif_conversion.hpp"
+#include "../bench/generators.hpp"
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @file Equivalence of the conversion of a SIF file through the external sort (--memory-limit) with the conversion in memory, for plain
+/// and gzipped inputs. The edges do not fit into the budget of a sorter, so they are sorted in several runs. The models must be the same byte for byte.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+const vector<Generators::SifParameters> SIF_SHAPES = { { 10000, 100000, 0., 1 }, { 10000, 100000, 1.5, 2 } }; ///< Uniform and power-law in-degrees.
+const size_t MEMORY_LIMIT = 1 << 22; ///< Far below the conversion in memory of the shapes, the sorters get their least budget.
+
+// @return	the content of the file
+string readBytes(const bfs::path & path) {
+	ifstream file(path.string(), ios::in | ios::binary);
+	return string{ istreambuf_iterator<char>(file), istreambuf_iterator<char>() };
+}
+
+// @return	the model converted from the content, written as the input in a directory of its own
+string convertIn(const bfs::path & dir, const string & input_name, const string & content, const ModelSettings & settings) {
+	bfs::create_directories(dir);
+	const bfs::path input = dir / input_name;
+	OutputBuffer output;
+	output << content;
+	output.writeToFile(input.string());
+	convertFile(input, settings);
+	return readBytes(dir / ("g" + MODEL_EXTENSION));
+}
+
+int main() {
+	size_t failures = 0;
+	auto check = [&failures](const bool condition, const string & message) {
+		if (!condition) {
+			cerr << "Failed: " << message << "\n";
+			failures++;
+		}
+	};
+
+	ExternalSort::TemporaryDirectory directory;
+	const bfs::path work = directory.newFile();
+	const ModelSettings in_memory{ 1, "", 0, NetworkCompression::CompressionSettings{}, false, CompressedStreams::Codec::None };
+	ModelSettings external = in_memory;
+	external.memory_limit = MEMORY_LIMIT;
+
+	for (const size_t shape_no : cscope(SIF_SHAPES)) {
+		const string content = Generators::generateSif(SIF_SHAPES[shape_no]);
+		for (const string input_name : { string{ "g.sif" }, "g.sif" + GZIP_EXTENSION }) {
+			const string variant = "shape " + to_string(shape_no) + ", " + input_name;
+			const bfs::path variant_dir = work / (to_string(shape_no) + "_" + input_name);
+			const string expected = convertIn(variant_dir / "memory", input_name, content, in_memory);
+			check(!needsExternal(variant_dir / "memory" / input_name, in_memory), variant + ": the conversion without a limit is in memory");
+
+			const string sorted = convertIn(variant_dir / "external", input_name, content, external);
+			check(needsExternal(variant_dir / "external" / input_name, external), variant + ": the memory limit leads to the external sort");
+			check(!expected.empty(), variant + ": the conversion in memory writes a model");
+			check(sorted == expected, variant + ": the model of the external sort is the same as in memory");
+		}
+	}
+
+	cout << (failures == 0 ? "The conversion through the external sort writes the same models as in memory.\n" : "The conversion through the external sort differs from the conversion in memory.\n");
+	return failures == 0 ? 0 : 1;
+}